@@ -0,0 +1,258 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GMGBackgroundSubtractor.h"
+
+// A connected region of foreground pixels.
+struct Blob
+{
+  size_t area;               // number of pixels in the blob
+  float centroidX;           // mean column of the pixels
+  float centroidY;           // mean row of the pixels
+  FGBoundingBox boundingBox; // smallest box containing the blob
+  float meanValue;           // mean input value (temperature for the GridEYE) over the blob
+};
+
+
+// Groups the foreground pixels of a mask into 4-connected blobs, the same neighbourhood used by
+// GMGBackgroundSubtractor's smoothing, and summarises each one. Intended to run after the
+// subtractor's update so consumers can work with a handful of blobs instead of the full mask.
+//
+// Labelling is a single raster pass with union-find: each foreground pixel takes the label of its
+// left or upper neighbour, labels that meet are merged, and the per-label statistics are folded
+// into their roots at the end. Only the current and previous row of labels are kept. All storage
+// is fixed size and nothing is allocated.
+// @tparam T The type of the input image.
+// @tparam X The width of the input image.
+// @tparam Y The height of the input image.
+// @tparam MAX_BLOBS The maximum number of blobs reported. The largest blobs are kept.
+template <typename T, size_t X, size_t Y, size_t MAX_BLOBS>
+class BlobExtractor
+{
+public:
+    BlobExtractor(void);
+
+    // @brief Find the blobs in a foreground mask
+    // @param packedMask Row-major mask packed 8 pixels per byte, as from
+    // GMGBackgroundSubtractor::getPackedForegroundMask()
+    // @param src The input image the mask was computed from, used for the blob mean values
+    void update(const uint8_t *packedMask, const T *src);
+
+    // @brief The blobs found by the last update, largest first
+    const Blob *getBlobs(void) const { return _blobs; }
+    size_t getNumBlobs(void) const { return _numBlobs; }
+
+    // @brief Number of regions found by the last update that met the minimum area,
+    // which may be more than getNumBlobs() if MAX_BLOBS was exceeded
+    size_t getNumRegions(void) const { return _numRegions; }
+
+    // getters and setters
+
+    // Regions with fewer pixels than this are ignored.
+    void setMinArea(size_t area) { _minArea = area; }
+    size_t getMinArea(void) { return _minArea; }
+
+private:
+    // Label 0 means background, so provisional labels start at 1. A 4-connected checkerboard
+    // is the worst case, with one label for every other pixel.
+    static const size_t MAX_LABELS = (X * Y + 1) / 2 + 1;
+
+    // @brief Running statistics of a provisional label
+    struct LabelStats
+    {
+        uint32_t area;
+        uint32_t sumX;
+        uint32_t sumY;
+        float sumValue;
+        uint16_t xMin, yMin, xMax, yMax;
+    };
+
+    // @brief Root label of a set, halving the path as it goes
+    uint32_t find(uint32_t label);
+
+    // @brief Merge the sets of two labels and return the root, always the smaller label
+    uint32_t merge(uint32_t a, uint32_t b);
+
+    // @brief Add a region to the output, keeping the largest MAX_BLOBS sorted by area
+    void addBlob(const LabelStats &stats);
+
+    // @brief Union-find forest over provisional labels, _parent[l] == l for roots
+    uint32_t _parent[MAX_LABELS];
+
+    // @brief Statistics gathered under each provisional label
+    LabelStats _stats[MAX_LABELS];
+
+    // @brief Labels of the previous and current row
+    uint32_t _rowLabels[2][X];
+
+    Blob _blobs[MAX_BLOBS];
+    size_t _numBlobs;
+    size_t _numRegions;
+
+    size_t _minArea;
+};
+
+template <typename T, size_t X, size_t Y, size_t MAX_BLOBS>
+BlobExtractor<T, X, Y, MAX_BLOBS>::BlobExtractor(void)
+{
+    // default values
+    _minArea = 1;
+    _numBlobs = 0;
+    _numRegions = 0;
+}
+
+template <typename T, size_t X, size_t Y, size_t MAX_BLOBS>
+uint32_t BlobExtractor<T, X, Y, MAX_BLOBS>::find(uint32_t label)
+{
+    while (_parent[label] != label)
+    {
+        _parent[label] = _parent[_parent[label]];
+        label = _parent[label];
+    }
+    return label;
+}
+
+template <typename T, size_t X, size_t Y, size_t MAX_BLOBS>
+uint32_t BlobExtractor<T, X, Y, MAX_BLOBS>::merge(uint32_t a, uint32_t b)
+{
+    a = find(a);
+    b = find(b);
+    if (a < b)
+    {
+        _parent[b] = a;
+        return a;
+    }
+    _parent[a] = b;
+    return b;
+}
+
+template <typename T, size_t X, size_t Y, size_t MAX_BLOBS>
+void BlobExtractor<T, X, Y, MAX_BLOBS>::addBlob(const LabelStats &stats)
+{
+    // find where this region goes, largest first
+    size_t pos = _numBlobs;
+    while (pos > 0 && _blobs[pos - 1].area < stats.area)
+    {
+        pos--;
+    }
+    if (pos >= MAX_BLOBS)
+    {
+        return;
+    }
+
+    // make room, dropping the smallest if full
+    size_t end = _numBlobs < MAX_BLOBS ? _numBlobs : MAX_BLOBS - 1;
+    for (size_t i = end; i > pos; --i)
+    {
+        _blobs[i] = _blobs[i - 1];
+    }
+    if (_numBlobs < MAX_BLOBS)
+    {
+        _numBlobs++;
+    }
+
+    Blob &blob = _blobs[pos];
+    blob.area = stats.area;
+    blob.centroidX = (float)stats.sumX / stats.area;
+    blob.centroidY = (float)stats.sumY / stats.area;
+    blob.boundingBox = FGBoundingBox{stats.xMin, stats.yMin, stats.xMax, stats.yMax};
+    blob.meanValue = stats.sumValue / stats.area;
+}
+
+template <typename T, size_t X, size_t Y, size_t MAX_BLOBS>
+void BlobExtractor<T, X, Y, MAX_BLOBS>::update(const uint8_t *packedMask, const T *src)
+{
+    uint32_t numLabels = 0;
+    _numBlobs = 0;
+    _numRegions = 0;
+
+    for (size_t y = 0; y < Y; ++y)
+    {
+        uint32_t *previous = _rowLabels[(y + 1) & 1];
+        uint32_t *current = _rowLabels[y & 1];
+
+        for (size_t x = 0; x < X; ++x)
+        {
+            size_t p = y * X + x;
+            uint8_t byte = packedMask[p >> 3];
+
+            // skip the rest of an empty byte in one go
+            if (byte == 0)
+            {
+                size_t run = 8 - (p & 7);
+                for (size_t i = 0; i < run && x < X; ++i, ++x)
+                {
+                    current[x] = 0;
+                }
+                --x;
+                continue;
+            }
+            if (((byte >> (p & 7)) & 1) == 0)
+            {
+                current[x] = 0;
+                continue;
+            }
+
+            uint32_t left = x > 0 ? current[x - 1] : 0;
+            uint32_t up = y > 0 ? previous[x] : 0;
+            uint32_t label;
+            if (left == 0 && up == 0)
+            {
+                label = ++numLabels;
+                _parent[label] = label;
+                _stats[label] = LabelStats{0, 0, 0, 0.0f, (uint16_t)x, (uint16_t)y, (uint16_t)x, (uint16_t)y};
+            }
+            else if (left == 0 || up == 0 || left == up)
+            {
+                label = left != 0 ? left : up;
+            }
+            else
+            {
+                label = merge(left, up);
+            }
+            current[x] = label;
+
+            LabelStats &stats = _stats[label];
+            stats.area++;
+            stats.sumX += x;
+            stats.sumY += y;
+            stats.sumValue += (float)src[p];
+            stats.xMin = x < stats.xMin ? x : stats.xMin;
+            stats.xMax = x > stats.xMax ? x : stats.xMax;
+            stats.yMin = y < stats.yMin ? y : stats.yMin;
+            stats.yMax = y > stats.yMax ? y : stats.yMax;
+        }
+    }
+
+    // fold the statistics of merged labels into their roots. Roots are always the smallest label
+    // of their set, so every label is folded after its root has been seen.
+    for (uint32_t label = 1; label <= numLabels; ++label)
+    {
+        uint32_t root = find(label);
+        if (root == label)
+        {
+            continue;
+        }
+        LabelStats &to = _stats[root];
+        const LabelStats &from = _stats[label];
+        to.area += from.area;
+        to.sumX += from.sumX;
+        to.sumY += from.sumY;
+        to.sumValue += from.sumValue;
+        to.xMin = from.xMin < to.xMin ? from.xMin : to.xMin;
+        to.xMax = from.xMax > to.xMax ? from.xMax : to.xMax;
+        to.yMin = from.yMin < to.yMin ? from.yMin : to.yMin;
+        to.yMax = from.yMax > to.yMax ? from.yMax : to.yMax;
+    }
+
+    for (uint32_t label = 1; label <= numLabels; ++label)
+    {
+        if (_parent[label] == label && _stats[label].area >= _minArea)
+        {
+            _numRegions++;
+            addBlob(_stats[label]);
+        }
+    }
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "BlobExtractor.h"
+
+// A blob followed across frames.
+struct Track
+{
+  uint32_t id;      // unique for the lifetime of the tracker, never reused
+  float x;          // filtered centroid column
+  float y;          // filtered centroid row
+  float vx;         // filtered velocity in columns per unit of dt
+  float vy;         // filtered velocity in rows per unit of dt
+  Blob blob;        // the blob last associated with this track
+  uint16_t hits;    // number of frames a blob has been associated
+  uint16_t misses;  // consecutive frames without an associated blob
+  bool confirmed;   // has been seen often enough to be reported as a person
+};
+
+
+// Follows the blobs from a BlobExtractor over time so that each person keeps the same id.
+//
+// Every track runs a constant-velocity Kalman filter on the blob centroid, with the x and y axes
+// filtered independently. Each frame the tracks are predicted forward, then blobs are assigned to
+// tracks greedily, closest first, by the normalised innovation distance, and only if within the
+// gate. Unassigned blobs start tentative tracks which are confirmed after a number of hits; tracks
+// that go unassigned for too long are dropped. All storage is fixed size and nothing is allocated.
+// @tparam MAX_TRACKS The maximum number of tracks, tentative and confirmed.
+// @tparam MAX_BLOBS The maximum number of blobs given to update.
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+class BlobTracker
+{
+public:
+    BlobTracker(void);
+
+    // @brief Remove all tracks. It is called automatically by the constructor but can be called
+    // manually to reset. Ids keep counting up.
+    void init(void);
+
+    // @brief Advance the tracks by one frame and associate them with new blobs
+    // @param blobs The blobs of this frame, e.g. BlobExtractor::getBlobs()
+    // @param numBlobs Number of blobs, only the first MAX_BLOBS are used
+    // @param dt Time since the previous update, in whatever unit the velocities should be in
+    void update(const Blob *blobs, size_t numBlobs, float dt = 1.0f);
+
+    // @brief The current tracks, tentative and confirmed, in no particular order
+    const Track *getTracks(void) const { return _tracks; }
+    size_t getNumTracks(void) const { return _numTracks; }
+
+    // getters and setters
+
+    // Spectral density of the random acceleration driving the motion model, in pixels^2 / dt^3.
+    void setProcessNoise(float val) { _processNoise = val; }
+    float getProcessNoise(void) { return _processNoise; }
+
+    // Variance of a blob centroid measurement, in pixels^2.
+    void setMeasurementNoise(float val) { _measurementNoise = val; }
+    float getMeasurementNoise(void) { return _measurementNoise; }
+
+    // Largest normalised squared distance at which a blob may be assigned to a track.
+    void setGate(float val) { _gate = val; }
+    float getGate(void) { return _gate; }
+
+    // Number of hits before a tentative track is confirmed.
+    void setConfirmHits(uint16_t val) { _confirmHits = val; }
+    uint16_t getConfirmHits(void) { return _confirmHits; }
+
+    // Number of consecutive misses after which a track is dropped.
+    void setMaxMisses(uint16_t val) { _maxMisses = val; }
+    uint16_t getMaxMisses(void) { return _maxMisses; }
+
+private:
+    // @brief Kalman filter of one axis, state (position, velocity) and symmetric covariance
+    struct AxisFilter
+    {
+        float pos;
+        float vel;
+        float p00, p01, p11;
+    };
+
+    // @brief Start a filter at rest at the given position
+    void initFilter(AxisFilter &f, float pos);
+
+    // @brief Advance a filter by dt under the constant-velocity model
+    void predict(AxisFilter &f, float dt);
+
+    // @brief Correct a filter with a measured position
+    void correct(AxisFilter &f, float measurement);
+
+    // @brief Start a tentative track for a blob
+    void startTrack(const Blob &blob);
+
+    // @brief Remove a track, moving the last one into its place
+    void removeTrack(size_t i);
+
+    Track _tracks[MAX_TRACKS];
+    AxisFilter _filterX[MAX_TRACKS];
+    AxisFilter _filterY[MAX_TRACKS];
+    size_t _numTracks;
+    uint32_t _nextId;
+
+    // CHANGEABLE PARAMETERS
+    // These are given default values in the constructor. Use the setter functions to change them.
+
+    float _processNoise;
+    float _measurementNoise;
+    float _gate;
+    uint16_t _confirmHits;
+    uint16_t _maxMisses;
+};
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+BlobTracker<MAX_TRACKS, MAX_BLOBS>::BlobTracker(void)
+{
+    // default values
+    _processNoise = 0.05f;
+    _measurementNoise = 0.25f;
+    _gate = 9.21f; // chi-squared, 2 degrees of freedom, 99%
+    _confirmHits = 3;
+    _maxMisses = 5;
+    _nextId = 1;
+
+    init();
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::init(void)
+{
+    _numTracks = 0;
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::initFilter(AxisFilter &f, float pos)
+{
+    f.pos = pos;
+    f.vel = 0.0f;
+    f.p00 = _measurementNoise;
+    f.p01 = 0.0f;
+    // unknown velocity, allow roughly a blob width per frame
+    f.p11 = 1.0f;
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::predict(AxisFilter &f, float dt)
+{
+    // x = F x, P = F P F' + Q with F = [1 dt; 0 1] and Q from white noise acceleration
+    float dt2 = dt * dt;
+    f.pos += f.vel * dt;
+    f.p00 += dt * (2.0f * f.p01 + dt * f.p11) + _processNoise * dt2 * dt / 3.0f;
+    f.p01 += dt * f.p11 + _processNoise * dt2 / 2.0f;
+    f.p11 += _processNoise * dt;
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::correct(AxisFilter &f, float measurement)
+{
+    // measurement of position only, H = [1 0]
+    float s = f.p00 + _measurementNoise;
+    float k0 = f.p00 / s;
+    float k1 = f.p01 / s;
+    float innovation = measurement - f.pos;
+    f.pos += k0 * innovation;
+    f.vel += k1 * innovation;
+    f.p11 -= k1 * f.p01;
+    f.p01 -= k0 * f.p01;
+    f.p00 -= k0 * f.p00;
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::startTrack(const Blob &blob)
+{
+    if (_numTracks >= MAX_TRACKS)
+    {
+        return;
+    }
+    size_t i = _numTracks++;
+    initFilter(_filterX[i], blob.centroidX);
+    initFilter(_filterY[i], blob.centroidY);
+
+    Track &track = _tracks[i];
+    track.id = _nextId++;
+    track.x = blob.centroidX;
+    track.y = blob.centroidY;
+    track.vx = 0.0f;
+    track.vy = 0.0f;
+    track.blob = blob;
+    track.hits = 1;
+    track.misses = 0;
+    track.confirmed = _confirmHits <= 1;
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::removeTrack(size_t i)
+{
+    _numTracks--;
+    _tracks[i] = _tracks[_numTracks];
+    _filterX[i] = _filterX[_numTracks];
+    _filterY[i] = _filterY[_numTracks];
+}
+
+template <size_t MAX_TRACKS, size_t MAX_BLOBS>
+void BlobTracker<MAX_TRACKS, MAX_BLOBS>::update(const Blob *blobs, size_t numBlobs, float dt)
+{
+    if (numBlobs > MAX_BLOBS)
+    {
+        numBlobs = MAX_BLOBS;
+    }
+
+    for (size_t t = 0; t < _numTracks; ++t)
+    {
+        predict(_filterX[t], dt);
+        predict(_filterY[t], dt);
+    }
+
+    // normalised squared innovation of every track/blob pair, negative if outside the gate
+    float cost[MAX_TRACKS][MAX_BLOBS];
+    for (size_t t = 0; t < _numTracks; ++t)
+    {
+        float sx = _filterX[t].p00 + _measurementNoise;
+        float sy = _filterY[t].p00 + _measurementNoise;
+        for (size_t b = 0; b < numBlobs; ++b)
+        {
+            float dx = blobs[b].centroidX - _filterX[t].pos;
+            float dy = blobs[b].centroidY - _filterY[t].pos;
+            float d = dx * dx / sx + dy * dy / sy;
+            cost[t][b] = d <= _gate ? d : -1.0f;
+        }
+    }
+
+    // greedy assignment, cheapest pair first
+    bool trackAssigned[MAX_TRACKS] = {};
+    bool blobAssigned[MAX_BLOBS] = {};
+    for (;;)
+    {
+        float best = -1.0f;
+        size_t bestTrack = 0;
+        size_t bestBlob = 0;
+        for (size_t t = 0; t < _numTracks; ++t)
+        {
+            if (trackAssigned[t])
+            {
+                continue;
+            }
+            for (size_t b = 0; b < numBlobs; ++b)
+            {
+                if (!blobAssigned[b] && cost[t][b] >= 0.0f && (best < 0.0f || cost[t][b] < best))
+                {
+                    best = cost[t][b];
+                    bestTrack = t;
+                    bestBlob = b;
+                }
+            }
+        }
+        if (best < 0.0f)
+        {
+            break;
+        }
+
+        trackAssigned[bestTrack] = true;
+        blobAssigned[bestBlob] = true;
+        correct(_filterX[bestTrack], blobs[bestBlob].centroidX);
+        correct(_filterY[bestTrack], blobs[bestBlob].centroidY);
+
+        Track &track = _tracks[bestTrack];
+        track.blob = blobs[bestBlob];
+        track.hits++;
+        track.misses = 0;
+        if (track.hits >= _confirmHits)
+        {
+            track.confirmed = true;
+        }
+    }
+
+    // age out unassigned tracks, iterating backwards as removal moves the last track forward
+    for (size_t t = _numTracks; t-- > 0;)
+    {
+        if (!trackAssigned[t])
+        {
+            _tracks[t].misses++;
+            // a tentative track has to be seen every frame until it is confirmed
+            if (_tracks[t].misses > _maxMisses || !_tracks[t].confirmed)
+            {
+                removeTrack(t);
+            }
+        }
+    }
+
+    for (size_t t = 0; t < _numTracks; ++t)
+    {
+        _tracks[t].x = _filterX[t].pos;
+        _tracks[t].y = _filterY[t].pos;
+        _tracks[t].vx = _filterX[t].vel;
+        _tracks[t].vy = _filterY[t].vel;
+    }
+
+    for (size_t b = 0; b < numBlobs; ++b)
+    {
+        if (!blobAssigned[b])
+        {
+            startTrack(blobs[b]);
+        }
+    }
+}
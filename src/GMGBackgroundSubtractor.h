@@ -1,5 +1,27 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GMGConfig.h"
+#include "GMGMemory.h"
+
+#if defined(GMG_ENABLE_THREADS)
+#include "GMGThreadPool.h"
+#endif
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+// Target size in bytes of the background model covered by one tile in the parallel update.
+// Tiles are whole rows, so a tile is never smaller than one row of the image.
+#ifndef GMG_TILE_BYTES
+#define GMG_TILE_BYTES (256 * 1024)
+#endif
+
 // return value from background subtractors.
 struct FGResult
 {
@@ -7,32 +29,145 @@ struct FGResult
   float confidence; // raw confidence value
 };
 
+// bounding box of the foreground pixels in an image, inclusive at both ends.
+// Empty when there is no foreground, in which case xMin > xMax and yMin > yMax.
+struct FGBoundingBox
+{
+  size_t xMin;
+  size_t yMin;
+  size_t xMax;
+  size_t yMax;
+  bool isEmpty(void) const { return xMin > xMax; }
+};
+
+// called for every pixel whose foreground state changed during an update.
+// @param context The pointer given to setChangeCallback
+// @param idx Row-major index of the pixel
+// @param isFG The new state of the pixel
+typedef void (*FGChangeCallback)(void *context, size_t idx, bool isFG);
+
+// which pixels update their background model in a frame when only some of them do.
+enum GMGUpdateSchedule
+{
+  GMG_UPDATE_ROUND_ROBIN, // every stride-th pixel, moving on by one each frame
+  GMG_UPDATE_RANDOM       // each pixel with probability 1 / stride, as in ViBe
+};
+
+// pixel index of each slot of a compacted model, see GMGBackgroundSubtractor's ACTIVE_MAX.
+template <size_t ACTIVE_MAX, bool COMPACT>
+struct GMGSlotMap
+{
+  uint32_t pixels[ACTIVE_MAX];
+  size_t operator[](size_t s) const { return pixels[s]; }
+};
+
+// without compaction every pixel has a slot and the slots are the pixels in order, so there is
+// nothing to store and the passes read the images sequentially.
+template <size_t ACTIVE_MAX>
+struct GMGSlotMap<ACTIVE_MAX, false>
+{
+  size_t operator[](size_t s) const { return s; }
+};
+
 
 // Class for performing background subtraction following "Visual Tracking of Human Visitors under
 // Variable-Lighting Conditions for a Responsive Audio Art Installation," A. Godbehere,
 // A. Matsukawa, K. Goldberg, American Control Conference, Montreal, June 2012.
+// Images are stored row-major, matching the order sensors emit pixels in: pixel (x, y) lives at
+// index y * X + x of the input, model and output buffers.
 // @tparam T The type of the input image.
 // @tparam X The width of the input image.
 // @tparam Y The height of the input image.
 // @tparam F_MAX The maximum number of features in the background model for each pixel.
-template <typename T, size_t X, size_t Y, size_t F_MAX>
+// @tparam ACTIVE_MAX The maximum number of pixels in the region of interest. Model storage is only
+// allocated for this many pixels. If less than X * Y, nothing is processed until a region of
+// interest is set. If X * Y, the default, every pixel is always processed and no region of
+// interest can be set.
+// @tparam CONFIG GMGRuntimeConfig for parameters settable at runtime, or a struct of compile-time
+// parameters as described in GMGConfig.h. See also FixedGMGBackgroundSubtractor.
+// @tparam STORAGE GMGInternalImages to keep the image buffers in the object, or GMGExternalImages
+// to place them separately as described in GMGMemory.h. See also SplitGMGBackgroundSubtractor.
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX = X * Y, typename CONFIG = GMGRuntimeConfig,
+          typename STORAGE = GMGInternalImages>
 class GMGBackgroundSubtractor
 {
+    static_assert(ACTIVE_MAX <= X * Y, "ACTIVE_MAX can not exceed the number of pixels");
+
 public:
+    typedef GMGImageBuffers<X, Y> ImageBuffers;
+    typedef STORAGE Storage;
+
     GMGBackgroundSubtractor(void);
+    // @brief Construct a subtractor with GMGExternalImages storage
+    // @param images The image buffers, which must outlive the subtractor
+    explicit GMGBackgroundSubtractor(ImageBuffers &images);
     ~GMGBackgroundSubtractor(void);
 
+    // the image buffers are referred to by pointer, which a copy would share
+    GMGBackgroundSubtractor(const GMGBackgroundSubtractor &) = delete;
+    GMGBackgroundSubtractor &operator=(const GMGBackgroundSubtractor &) = delete;
+
     // @brief Sets the model parameters to zero and begins the process at training mode. It is called
     // automatically by the constructor but can be called manually to reset
     void init(void);
 
     // @brief Update the model and foreground predictions
-    // @param image The image to update the model with
+    // @param image The image to update the model with, row-major with X pixels per row
     void update(T *src);
 
+    // @brief Update the model and foreground predictions, only scoring pixels in flagged blocks.
+    // Pixels in blocks that are not flagged are taken to be background: their posterior is zero and
+    // they only update the background model, cheaply if their value is unchanged. Training frames
+    // ignore the mask. See HierarchicalGMGBackgroundSubtractor.
+    // @param image The image to update the model with, row-major with X pixels per row
+    // @param blockMask One flag per blockSize x blockSize block, row-major with
+    // (X + blockSize - 1) / blockSize blocks per row, or nullptr to score every pixel
+    // @param blockSize Width and height of a block in pixels, or 0 to score every pixel
+    void update(T *src, const bool *blockMask, size_t blockSize);
+
+    // @brief Foreground result for a pixel
+    // @param idx Row-major pixel index, i.e. y * X + x
     FGResult isFG(size_t idx);
+    // @brief Foreground result for a pixel
+    // @param x Column, 0 <= x < X
+    // @param y Row, 0 <= y < Y
     FGResult isFG(size_t x, size_t y);
 
+    // Bulk results. These are views of internal buffers, valid until the next call to update() or init().
+
+    // @brief Number of bytes in the packed foreground mask
+    static const size_t PACKED_MASK_BYTES = (X * Y + 7) / 8;
+
+    // @brief The foreground mask, one bool per pixel, row-major
+    const bool *getForegroundImage(void) const { return _binaryImage; }
+
+    // @brief The foreground mask packed 8 pixels per byte, row-major, pixel idx in bit (idx % 8)
+    // of byte (idx / 8). PACKED_MASK_BYTES long, unused bits of the last byte are zero.
+    const uint8_t *getPackedForegroundMask(void) const { return _packedMask; }
+
+    // @brief The probability of each pixel being foreground, row-major
+    const float *getConfidenceImage(void) const { return _posteriorImage; }
+
+    // @brief Number of foreground pixels in the current mask
+    size_t getForegroundCount(void) const { return _foregroundCount; }
+
+    // @brief Smallest box containing every foreground pixel of the current mask
+    FGBoundingBox getBoundingBox(void) const { return _boundingBox; }
+
+    // @brief Row-major indices of the pixels whose foreground state changed in the last update,
+    // in increasing order. getNumChangedPixels() long.
+    const uint32_t *getChangedPixels(void) const { return _changedPixels; }
+    size_t getNumChangedPixels(void) const { return _numChangedPixels; }
+
+    // @brief Call a function for each pixel whose foreground state changes, at the end of update()
+    // @param callback The function to call, or nullptr to disable
+    // @param context Passed to the callback unchanged
+    void setChangeCallback(FGChangeCallback callback, void *context = nullptr)
+    {
+        _changeCallback = callback;
+        _changeCallbackContext = context;
+    }
+
     // @brief Is the model in initial training mode?
     bool isTraining(void) const { return _frameNum < _numInitialisationFrames; }
 
@@ -41,67 +176,234 @@ public:
     void setNumInitialisationFrames(uint64_t numInitialisationFrames) { _numInitialisationFrames = numInitialisationFrames; }
     uint64_t getNumInitialisationFrames(void) { return _numInitialisationFrames; }
 
-    void setBackgroundPrior(float backgroundPrior) { _backgroundPrior = backgroundPrior; }
-    float getBackgroundPrior(void) { return _backgroundPrior; }
+    // The model parameters and input range below are staged: they take effect together at the
+    // start of the next update(), which never mixes old and new values within a frame. They may be
+    // set from an interrupt or another thread while update() runs, and update() may run in an
+    // interrupt while they are set, but they must only be set from one context at a time. An
+    // update() that starts while a setter is still running keeps the previous values, and the
+    // change takes effect an update later. The getters return the staged values. The model
+    // parameters can only be set with the default GMGRuntimeConfig.
+
+    void setBackgroundPrior(float backgroundPrior) { setParam(_staged.params.backgroundPrior, backgroundPrior); }
+    float getBackgroundPrior(void) { return _staged.params.backgroundPrior; }
+
+    void setLearningRate(float learningRate) { setParam(_staged.params.learningRate, learningRate); }
+    float getLearningRate(void) { return _staged.params.learningRate; }
+
+    void setMinVal(T val) { stage(_staged.minVal, val); }
+    T getMinVal(void) { return _staged.minVal; }
+
+    void setMaxVal(T val) { stage(_staged.maxVal, val); }
+    T getMaxVal(void) { return _staged.maxVal; }
+
+    void setDecisionThreshold(float val) { setParam(_staged.params.decisionThreshold, val); }
+    float getDecisionThreshold(void) { return _staged.params.decisionThreshold; }
+
+    void setQuantisationLevels(uint16_t val) { setParam(_staged.params.quantisationLevels, val); }
+    uint16_t getQuantisationLevels(void) { return _staged.params.quantisationLevels; }
+
+    // @brief Restrict all processing to a region of interest. Pixels outside it are never trained,
+    // scored or updated, always read as background, and take no model storage. Resets the model
+    // and restarts training.
+    // @param packedMask Row-major mask packed 8 pixels per byte like getPackedForegroundMask(),
+    // set bits are processed
+    // @return false, leaving the region unchanged, if the region has more than ACTIVE_MAX pixels.
+    // Only available when ACTIVE_MAX is less than X * Y.
+    bool setRegionOfInterest(const uint8_t *packedMask);
+
+    // @brief Process every pixel again. Resets the model and restarts training.
+    // @return false, leaving the region unchanged, if ACTIVE_MAX is less than X * Y
+    bool clearRegionOfInterest(void);
+
+    // @brief Number of pixels in the region of interest
+    size_t getNumActivePixels(void) const { return _rowSlotBegin[Y]; }
+
+    // @brief Skip the model search and update for pixels that quantise to the same bin as last frame
+    // and were background. Their posterior comes from a cached copy of that bin's weight, and the
+    // decay of the other bins is applied in one go the next time the pixel takes the full path.
+    // The result matches the full update up to float rounding.
+    void setChangeGating(bool enabled) { _changeGating = enabled; }
+    bool getChangeGating(void) { return _changeGating; }
 
-    void setLearningRate(float learningRate) { _learningRate = learningRate; }
-    float getLearningRate(void) { return _learningRate; }
+    // @brief Smooth the foreground mask within segments of this many columns only, as if each were
+    // a separate image. For images made of several sensors side by side, see
+    // MultiSensorGMGBackgroundSubtractor.
+    // @param width Columns per segment, from the left edge; X, the default, for whole rows
+    void setSmoothingWidth(size_t width) { _smoothingWidth = width < 1 ? 1 : (width > X ? X : width); }
+    size_t getSmoothingWidth(void) { return _smoothingWidth; }
 
-    void setMinVal(T val) { _minVal = val; }
-    T getMinVal(void) { return _minVal; }
+    // @brief Fraction of pixels that took the change-gated fast path in the last update. Zero
+    // while change gating is off. Pixels outside the flagged blocks of update(src, blockMask,
+    // blockSize) are not counted, even when they update through the same cache.
+    float getFastPathFraction(void) const { return _fastPathFraction; }
 
-    void setMaxVal(T val) { _maxVal = val; }
-    T getMaxVal(void) { return _maxVal; }
+    // @brief Largest stride of the partial model update
+    static const size_t MAX_UPDATE_STRIDE = 64;
 
-    void setDecisionThreshold(float val) { _decisionThreshold = val; }
-    float getDecisionThreshold(void) { return _decisionThreshold; }
+    // @brief Largest learning rate the partial model update raises the updated pixels' rate to
+    static constexpr float MAX_SCHEDULED_LEARNING_RATE = 0.2f;
 
-    void setQuantisationLevels(uint16_t val) { _quantisationLevels = val; }
-    uint16_t getQuantisationLevels(void) { return _quantisationLevels; }
+    // @brief Update the background model of only about one in every stride pixels each frame.
+    // Every pixel is still scored every frame. The updated pixels use a learning rate of
+    // 1 - (1 - learningRate)^stride so the model adapts as fast as before, lagging by about stride
+    // frames. Pixels on the change-gated fast path are cheap and keep updating every frame.
+    // The raised rate is capped at MAX_SCHEDULED_LEARNING_RATE (a stride of 8 at the default
+    // learning rate), as near 1 each update would all but replace the model with a single noisy
+    // sample. Larger strides only skip updates, as in ViBe: they still save time, but the model then
+    // adapts about stride / (capped stride) times more slowly.
+    // @param stride 1 to update every pixel, up to MAX_UPDATE_STRIDE
+    void setUpdateStride(size_t stride) { _updateStride = stride < 1 ? 1 : (stride > MAX_UPDATE_STRIDE ? MAX_UPDATE_STRIDE : stride); }
+    // @brief The stride in use, which is chosen automatically while an update budget is set
+    size_t getUpdateStride(void) { return _updateStride; }
+
+    void setUpdateSchedule(GMGUpdateSchedule schedule) { _updateSchedule = schedule; }
+    GMGUpdateSchedule getUpdateSchedule(void) { return _updateSchedule; }
+
+    // @brief Choose the update stride after each frame so that update() takes about the given time.
+    // Scoring is never skipped, so if it alone takes longer the stride goes to MAX_UPDATE_STRIDE
+    // and the budget is overrun. Strides past the learning rate cap slow adaptation, see above.
+    // @param micros Time budget of one update in microseconds, 0 to keep the stride fixed
+    void setUpdateBudget(uint32_t micros) { _updateBudget = micros; }
+    uint32_t getUpdateBudget(void) { return _updateBudget; }
+
+    // @brief Bytes of the per-pixel model, which should be in the fastest memory. See GMGFootprint.h.
+    static constexpr size_t getModelBytes(void)
+    {
+        return (COMPACT ? sizeof(_slotPixel) : 0) + sizeof(_rowSlotBegin) + sizeof(pmf) + sizeof(_gate) + sizeof(_quantisedImage);
+    }
+
+    // @brief Bytes of the image buffers, inside the object unless STORAGE is GMGExternalImages
+    static constexpr size_t getImageBytes(void) { return sizeof(ImageBuffers); }
+
+#if defined(GMG_ENABLE_THREADS)
+    // @brief Run update() across the threads of a pool by splitting the image into tiles of whole rows.
+    // The output is identical to the serial path. The pool must outlive its use here.
+    // @param pool The pool to use, or nullptr to go back to the serial path
+    void setThreadPool(GMGThreadPool *pool) { _threadPool = pool; }
+    GMGThreadPool *getThreadPool(void) { return _threadPool; }
+
+    // @brief Set the number of rows in each tile of the parallel update
+    // @param rows Rows per tile, or 0 to size tiles to roughly GMG_TILE_BYTES of model
+    void setTileRows(size_t rows) { _tileRows = rows; }
+    size_t getTileRows(void) { return _tileRows; }
+#endif
 
 private:
+    typedef GMGParams<CONFIG> Params;
+
+    // @brief Point the image members at their buffers and set the default values.
+    // Called by the constructors.
+    void construct(ImageBuffers &images);
+
+    // @brief Change a staged value, marking _stagedVersion odd while doing so
+    template <typename V, typename A>
+    void stage(V &field, A val)
+    {
+        _stagedVersion = _stagedVersion + 1;
+        __sync_synchronize();
+        field = val;
+        __sync_synchronize();
+        _stagedVersion = _stagedVersion + 1;
+    }
+
+    // @brief Stage a runtime model parameter
+    template <typename V, typename A>
+    void setParam(V &param, A val)
+    {
+        static_assert(Params::IS_RUNTIME, "parameters of a fixed configuration can not be changed");
+        stage(param, val);
+    }
+
+    // @brief Take the staged parameters into use if they have changed and no change is in
+    // progress, and compute everything derived from them. Called at the start of update().
+    void applyStagedParams(void);
+
     // @brief Quantise values according to the minimum and maximum values
-    // and the number of quantisation levels
+    // and the number of quantisation levels, using the range taken into use at the start of update()
     // @param src The input value
-    // @param min The minimum of the range of input values
-    // @param max The maximum of the range of input values
-    // @param levels The number of quantisation levels
     // @return The quantised value
-    uint8_t quantize(T val, T min, T max, uint16_t levels);
+    uint8_t quantize(T val) const;
+
+    // The per-pixel stages below all work on the rows [rowBegin, rowEnd) so that the image can be
+    // split into tiles. Every stage only touches pixels in its rows, except smoothBinaryImage which
+    // also reads the raw decisions of the row above and below (the halo). update() therefore
+    // runs the stages in two passes, processRows then finishRows, with all tiles of the first
+    // pass complete before the second starts.
+
+    // @brief First pass over a tile: quantise, then train or make the raw foreground decisions.
+    // This is called by the update function and should not be called directly.
+    void processRows(size_t rowBegin, size_t rowEnd);
+
+    // @brief Second pass over a tile: smooth the decisions and update the background model.
+    // This is called by the update function and should not be called directly.
+    void finishRows(size_t rowBegin, size_t rowEnd);
 
     // @brief Update the model and foreground predictions in training mode.
     // This is called by the update function and should not be called directly.
     // Normalises the model after _numInitFrames frames have been processed.
-    void train(void);
+    void train(size_t rowBegin, size_t rowEnd);
     
     // @brief Update the internal quantised representation of the image.
     // This is called by the update function and should not be called directly.
-    void updateQuantisedImage(T *src);
+    void updateQuantisedImage(T *src, size_t rowBegin, size_t rowEnd);
     
-    // @brief Update the internal foreground and background predictions.
+    // @brief Update the internal foreground and background predictions, and make the raw
+    // foreground decisions by comparing background weights with the likelihood threshold.
+    // In change-gated mode this is also where stable background pixels take the fast path.
     // This is called by the update function and should not be called directly.
-    void updatePosteriorImage(void);
-    
-    // @brief Update the internal foreground and background predictions.
-    // This is called by the update function and should not be called directly.
-    void updateBinaryImage(void);
+    void updatePosteriorImage(size_t rowBegin, size_t rowEnd);
+
+    // @brief Probability of a pixel being foreground given the probability of its value under the
+    // background model, by Bayes' theorem
+    float foregroundPosterior(float pPixelGivenBackground) const;
+
+    // @brief Apply the decay skipped by the change-gated fast path to the model in a slot and
+    // invalidate its cache.
+    void foldPendingUpdates(size_t s);
+
+    // @brief Update the model in a slot through its gating cache, as the full update would for a
+    // background pixel whose value is in the cached bin.
+    void updateGate(size_t s);
     
     // @brief Update the background model during runtime. Only updates
-    // if the pixel is not foreground. This is called by the update function and should not be called directly.
-    void updateHistogram(void);
+    // if the pixel is not foreground and is scheduled this frame under the update stride.
+    // This is called by the update function and should not be called directly.
+    void updateHistogram(size_t rowBegin, size_t rowEnd);
+
+    // @brief Choose the update stride of the next frame from the time taken by this one
+    void adaptUpdateStride(uint32_t detectMicros, uint32_t learnMicros);
+
+    // @brief Free-running microsecond clock, wrapping at 2^32
+    static uint32_t nowMicros(void);
 
     // @brief Placeholder function for smoothing operations on the posterior image.
     // This is called by the update function and should not be called directly.
     // TODO - implement smoothing
     void smoothPosteriorImage(void);
 
-    // @brief Perform smoothing on the binary prediction image. 
+    // @brief Perform smoothing on the binary prediction image. Reads the raw decisions
+    // and writes the smoothed ones, so the result does not depend on the order pixels are visited in.
     // This is called by the update function and should not be called directly.
-    void smoothBinaryImage(void);
+    void smoothBinaryImage(size_t rowBegin, size_t rowEnd);
+
+    // @brief Pack the smoothed mask, work out which pixels changed and refresh the summary statistics.
+    // This is called by the update function and should not be called directly.
+    void updateResults(void);
+
+#if defined(GMG_ENABLE_THREADS)
+    // @brief Thread pool entry points, context is the subtractor and task the tile index
+    static void processTile(void *context, size_t tile);
+    static void finishTile(void *context, size_t tile);
 
+    // @brief Number of rows in each tile of the parallel update
+    size_t tileRows(void) const;
+#endif
+
+#if defined(ARDUINO)
     // @brief Print the current state of the model to the serial port.
     // Useful for debugging/insight.
     void printFeatures(void);
+#endif
 
     // @brief Representation of a single feature/bin in the model.
     struct Feature
@@ -118,17 +420,79 @@ private:
         Feature features[F_MAX];    // The feature set
     };
 
-    // @brief The background model. Contains a PMF for each pixel.
-    PMF pmf[X][Y];
+    // Per-pixel model state is stored compacted: only pixels in the region of interest get a slot,
+    // slots are in row-major pixel order, and _slotPixel maps a slot back to its pixel. The output
+    // images stay full size so that pixels outside the region read as background. Without room
+    // for a region of interest, slot and pixel are the same.
+
+    // @brief Is there a region of interest, so that slots need mapping to pixels?
+    static const bool COMPACT = ACTIVE_MAX < X * Y;
+
+    // @brief Pixel index of each slot.
+    GMGSlotMap<ACTIVE_MAX, COMPACT> _slotPixel;
+
+    // @brief First slot of each row; the slots of row y are [_rowSlotBegin[y], _rowSlotBegin[y + 1]).
+    uint32_t _rowSlotBegin[Y + 1];
+
+    // @brief The background model. Contains a PMF for each slot.
+    PMF pmf[ACTIVE_MAX];
 
-    // @brief Representation of the input image as a quantised image.
-    uint8_t _quantisedImage[X][Y];
+    // @brief Per-pixel cache used by the change-gated fast path.
+    // While pendingDecay < 1 the model is out of date: the weight of features[bin] is
+    // binProbability and every other weight must still be multiplied by pendingDecay. Like the
+    // full update, each skipped update divides by the sum of the weights, which is only 1 until a
+    // feature has been replaced, so the sum is cached too.
+    struct GateState
+    {
+        float binProbability;   // Weight of the cached bin, including skipped updates
+        float pendingDecay;     // Product of the normalised decays of the skipped updates
+        float total;            // Sum of the weights, including skipped updates
+        uint8_t bin;            // Index of the feature holding the last quantised value
+        bool valid;             // bin and binProbability describe the model
+        bool fastPath;          // Took the fast path this frame, so the model update is already done
+    };
+
+    // @brief Change-gating cache for each slot.
+    GateState _gate[ACTIVE_MAX];
 
-    // @brief Representation of the input image as the probability of each pixel being foreground.
-    float _posteriorImage[X][Y];
+    // @brief Per-row counts of the last update, kept per row so that tiles never share a counter.
+    struct RowStats
+    {
+        uint32_t fastPathCount; // Pixels that took the change-gated fast path
+        uint32_t blockCount;    // Pixels outside the flagged blocks updated through the gating cache
+        uint32_t learnCount;    // Pixels that had a full model update
+    };
+    RowStats _rowStats[Y];
 
-    // @brief Representation of the input image as a binary image representing foreground/background.
-    bool _binaryImage[X][Y];
+    // @brief Representation of the input image as a quantised image, one value per slot.
+    uint8_t _quantisedImage[ACTIVE_MAX];
+
+    // The image buffers below point into an ImageBuffers, held in _imageStorage or given to the
+    // constructor.
+    typename STORAGE::template Holder<X, Y> _imageStorage;
+
+    // @brief Representation of the input image as the probability of each pixel being foreground, row-major.
+    float *_posteriorImage;
+
+    // @brief Per-pixel foreground decisions before smoothing, row-major.
+    bool *_rawBinaryImage;
+
+    // @brief Representation of the input image as a binary image representing foreground/background, row-major.
+    bool *_binaryImage;
+
+    // @brief _binaryImage packed into bits, as of the end of the last update.
+    uint8_t *_packedMask;
+
+    // @brief Pixels whose state changed in the last update, and how many there are.
+    uint32_t *_changedPixels;
+    size_t _numChangedPixels;
+
+    // @brief Summary of _binaryImage as of the end of the last update.
+    size_t _foregroundCount;
+    FGBoundingBox _boundingBox;
+
+    FGChangeCallback _changeCallback;
+    void *_changeCallbackContext;
 
     // TODO - There are a lot of different/expensive representations here.
     // This should be optimised for both speed and RAM usage.
@@ -137,122 +501,327 @@ private:
     // Used to determine when to exit training mode.
     uint64_t _frameNum;
 
+    // Image being processed by the current call to update()
+    T *_src;
+
+    // Blocks to score in the current call to update(), nullptr to score every pixel
+    const bool *_blockMask;
+    size_t _blockSize;
+
+    // Whether the current call to update() is training, fixed for the duration of the call
+    bool _training;
+
+    // Whether change gating is enabled, and the share of pixels that used it last update
+    bool _changeGating;
+    float _fastPathFraction;
+
+    // Columns per segment of the smoothing, X to smooth whole rows
+    size_t _smoothingWidth;
+
+    // Model update coefficients for the current stride, and the random sampling threshold out of 2^32
+    float _scheduledDecay;
+    float _scheduledLearningRate;
+    uint32_t _sampleThreshold;
+
+    // Smoothed time to score a frame and to fully update one pixel, for the update budget
+    float _detectMicros;
+    float _learnMicrosPerPixel;
+
+#if defined(GMG_ENABLE_THREADS)
+    // Pool used for the parallel update, nullptr for the serial path
+    GMGThreadPool *_threadPool;
+    // Rows per tile, 0 for automatic
+    size_t _tileRows;
+#endif
+
+    // Parameters in use, copied from _staged at the start of update() and fixed until the next,
+    // with the values derived from them.
+    Params _params;
+    T _minVal;
+    T _maxVal;
+    // Quantisation levels per unit of input, maxLevel / (_maxVal - _minVal)
+    float _quantScale;
+    // _stagedVersion of the parameters in use
+    uint32_t _appliedVersion;
+
 
     // CHANGEABLE PARAMETERS
     // These are given default values in the constructor. Use the setter functions to change them.
 
     // The number of frames to wait before ending training mode.
     uint64_t _numInitialisationFrames;
-    // Prior probability of a pixel being background. Used in Bayes' Rule
-    float _backgroundPrior;
-    // How quickly the background model updates (EMA).
-    float _learningRate;
-    // Probability threshold over which a pixel is considered foreground.
-    float _decisionThreshold;
-    // Number of quantisation levels. Represents the maximum possible features in the model.
-    uint16_t _quantisationLevels;
-    // Minimum value of the input image.
-    T _minVal;
-    // Maximum value of the input image.
-    T _maxVal;
+    // Staged by the setters and taken into use by the next update().
+    struct StagedParams
+    {
+        // Prior probability of a pixel being background (used in Bayes' Rule), how quickly the
+        // background model updates (EMA), probability threshold over which a pixel is considered
+        // foreground, and the number of quantisation levels, which is the maximum possible features
+        // in the model. Constants for a fixed configuration.
+        Params params;
+        // Minimum value of the input image.
+        T minVal;
+        // Maximum value of the input image.
+        T maxVal;
+    };
+    StagedParams _staged;
+    // Incremented before and after every change to _staged, so it is odd while one is being made.
+    volatile uint32_t _stagedVersion;
+    // Partial model update: pixels per updated pixel, how they are picked, and the time budget
+    // in microseconds (0 for a fixed stride).
+    size_t _updateStride;
+    GMGUpdateSchedule _updateSchedule;
+    uint32_t _updateBudget;
 
 };
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-GMGBackgroundSubtractor<T, X, Y, F_MAX>::GMGBackgroundSubtractor(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::GMGBackgroundSubtractor(void)
 {
-    // default values
-    _backgroundPrior = 0.8f;
-    _learningRate = 0.025f;
-    _decisionThreshold = 0.9f;
-    _quantisationLevels = 32;
-    _minVal = 0.0f;
-    _maxVal = 1.0f;
-    _numInitialisationFrames = 240;
+    static_assert(!STORAGE::EXTERNAL, "a subtractor with GMGExternalImages must be given its image buffers");
+    construct(*_imageStorage.get());
+}
 
-    init();
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::GMGBackgroundSubtractor(ImageBuffers &images)
+{
+    static_assert(STORAGE::EXTERNAL, "only a subtractor with GMGExternalImages takes image buffers");
+    construct(images);
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-GMGBackgroundSubtractor<T, X, Y, F_MAX>::~GMGBackgroundSubtractor(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::construct(ImageBuffers &images)
 {
+    _posteriorImage = images.posteriorImage;
+    _rawBinaryImage = images.rawBinaryImage;
+    _binaryImage = images.binaryImage;
+    _packedMask = images.packedMask;
+    _changedPixels = images.changedPixels;
+
+    // default values, the model parameters default to GMGDefaultConfig
+    _staged.minVal = 0.0f;
+    _staged.maxVal = 1.0f;
+    _stagedVersion = 0;
+    _appliedVersion = 1; // never a settled version, so the defaults are applied below
+    _numInitialisationFrames = 240;
+    _src = nullptr;
+    _blockMask = nullptr;
+    _blockSize = 1;
+    _training = true;
+    _changeCallback = nullptr;
+    _changeCallbackContext = nullptr;
+    _changeGating = false;
+    _smoothingWidth = X;
+    _updateStride = 1;
+    _updateSchedule = GMG_UPDATE_ROUND_ROBIN;
+    _updateBudget = 0;
+#if defined(GMG_ENABLE_THREADS)
+    _threadPool = nullptr;
+    _tileRows = 0;
+#endif
+    applyStagedParams();
+
+    // every pixel if there is room, otherwise none until a region is set
+    if (!clearRegionOfInterest())
+    {
+        for (size_t y = 0; y <= Y; ++y)
+        {
+            _rowSlotBegin[y] = 0;
+        }
+    }
+    init();
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::init(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+bool GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::setRegionOfInterest(const uint8_t *packedMask)
 {
-    for (size_t i = 0; i < X; ++i)
+    static_assert(COMPACT, "a region of interest needs ACTIVE_MAX less than X * Y");
+
+    // bits of the last byte past the final pixel are not pixels, whatever their value
+    size_t count = 0;
+    for (size_t i = 0; i < PACKED_MASK_BYTES; ++i)
     {
-        for (size_t j = 0; j < Y; ++j)
+        uint8_t bits = packedMask[i];
+        if (i == PACKED_MASK_BYTES - 1 && (X * Y) % 8 != 0)
         {
-            for (size_t k = 0; k < F_MAX; ++k)
+            bits &= (uint8_t)((1 << ((X * Y) % 8)) - 1);
+        }
+        count += __builtin_popcount(bits);
+    }
+    if (count > ACTIVE_MAX)
+    {
+        return false;
+    }
+
+    uint32_t slot = 0;
+    for (size_t y = 0; y < Y; ++y)
+    {
+        _rowSlotBegin[y] = slot;
+        for (size_t p = y * X; p < (y + 1) * X; ++p)
+        {
+            if ((packedMask[p >> 3] >> (p & 7)) & 1)
             {
-                pmf[i][j].features[k].pixelValue = 0;
-                pmf[i][j].features[k].probability = 0.0f;
+                _slotPixel.pixels[slot++] = (uint32_t)p;
             }
-            pmf[i][j].featureCount = 0;
         }
     }
-    _frameNum = 0;
+    _rowSlotBegin[Y] = slot;
+
+    init();
+    return true;
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-uint8_t GMGBackgroundSubtractor<T, X, Y, F_MAX>::quantize(T val, T min, T max, uint16_t levels)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+bool GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::clearRegionOfInterest(void)
 {
-    val = constrain(val, min, max);
-    float normalisedVal = (val - min) / (float)(max - min);
-    return (uint8_t)(normalisedVal * (levels - 1));
+    if (COMPACT)
+    {
+        return false;
+    }
+    for (size_t y = 0; y <= Y; ++y)
+    {
+        _rowSlotBegin[y] = (uint32_t)(y * X);
+    }
+
+    init();
+    return true;
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::train(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::~GMGBackgroundSubtractor(void)
 {
-    for (size_t x = 0; x < X; ++x)
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::init(void)
+{
+    for (size_t i = 0; i < ACTIVE_MAX; ++i)
     {
-        for (size_t y = 0; y < Y; ++y)
+        for (size_t k = 0; k < F_MAX; ++k)
         {
-            uint8_t pixelValue = _quantisedImage[x][y];
+            pmf[i].features[k].pixelValue = 0;
+            pmf[i].features[k].probability = 0.0f;
+        }
+        pmf[i].featureCount = 0;
+        _gate[i].binProbability = 0.0f;
+        _gate[i].pendingDecay = 1.0f;
+        _gate[i].total = 1.0f;
+        _gate[i].bin = 0;
+        _gate[i].valid = false;
+        _gate[i].fastPath = false;
+    }
+    for (size_t i = 0; i < X * Y; ++i)
+    {
+        _posteriorImage[i] = 0.0f;
+        _rawBinaryImage[i] = false;
+        _binaryImage[i] = false;
+    }
+    for (size_t i = 0; i < PACKED_MASK_BYTES; ++i)
+    {
+        _packedMask[i] = 0;
+    }
+    _numChangedPixels = 0;
+    _foregroundCount = 0;
+    _boundingBox = FGBoundingBox{X, Y, 0, 0};
+    for (size_t y = 0; y < Y; ++y)
+    {
+        _rowStats[y] = RowStats{0, 0, 0};
+    }
+    _fastPathFraction = 0.0f;
+    _detectMicros = 0.0f;
+    _learnMicrosPerPixel = 0.0f;
+    _sampleThreshold = 0xFFFFFFFFu;
+    _frameNum = 0;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::applyStagedParams(void)
+{
+    // Keep the parameters in use if a change is in progress or is made while copying. Waiting
+    // for the setter instead could spin forever if this update() has interrupted it, so the
+    // change is left to the next update().
+    uint32_t version = _stagedVersion;
+    if (version == _appliedVersion || (version & 1))
+    {
+        return;
+    }
+    __sync_synchronize();
+    StagedParams staged = _staged;
+    __sync_synchronize();
+    if (_stagedVersion != version)
+    {
+        return;
+    }
+
+    _params = staged.params;
+    _params.derive();
+    _minVal = staged.minVal;
+    _maxVal = staged.maxVal;
+    _quantScale = _params.maxLevel / (float)(_maxVal - _minVal);
+    _appliedVersion = version;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+uint8_t GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::quantize(T val) const
+{
+    // the top level is returned directly, as rounding in _quantScale can put _maxVal just under
+    // it, which truncation would then drop to the level below
+    if (val >= _maxVal)
+    {
+        return (uint8_t)_params.maxLevel;
+    }
+    if (val < _minVal)
+    {
+        val = _minVal;
+    }
+    return (uint8_t)((val - _minVal) * _quantScale);
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::train(size_t rowBegin, size_t rowEnd)
+{
+    for (size_t s = _rowSlotBegin[rowBegin]; s < _rowSlotBegin[rowEnd]; ++s)
+    {
+        uint8_t pixelValue = _quantisedImage[s];
 
-            // Find and update the PMF for this pixel
-            // (Note adding 1.0f is arbitrary as it is normalised later)
+        // Find and update the PMF for this pixel
+        // (Note adding 1.0f is arbitrary as it is normalised later)
 
-            bool present = false; // Is the pixel value already present in the model?
-            for (size_t i = 0; i < pmf[x][y].featureCount; ++i)
+        bool present = false; // Is the pixel value already present in the model?
+        for (size_t i = 0; i < pmf[s].featureCount; ++i)
+        {
+            if (pmf[s].features[i].pixelValue == pixelValue)
             {
-                if (pmf[x][y].features[i].pixelValue == pixelValue)
-                {
-                    pmf[x][y].features[i].probability += 1.0f;
-                    present = true;
-                    break;
-                }
+                pmf[s].features[i].probability += 1.0f;
+                present = true;
+                break;
             }
+        }
 
-            // If the pixel value is not already present, add it to the model
-            if (!present)
-            {
+        // If the pixel value is not already present, add it to the model
+        if (!present)
+        {
 
-                // If the model is not full, add the pixel value to the end
-                if (pmf[x][y].featureCount < F_MAX)
-                {
-                    pmf[x][y].features[pmf[x][y].featureCount].pixelValue = pixelValue;
-                    pmf[x][y].features[pmf[x][y].featureCount].probability = 1.0f;
-                    pmf[x][y].featureCount++;
-                }
+            // If the model is not full, add the pixel value to the end
+            if (pmf[s].featureCount < F_MAX)
+            {
+                pmf[s].features[pmf[s].featureCount].pixelValue = pixelValue;
+                pmf[s].features[pmf[s].featureCount].probability = 1.0f;
+                pmf[s].featureCount++;
+            }
 
-                // Otherwise discard the oldest feature and add the new one
-                else
+            // Otherwise discard the oldest feature and add the new one
+            else
+            {
+                // remove the first element of the array,
+                // shift all elements down by one, and insert the new element
+                // at the end of the array
+                for (size_t i = 0; i < F_MAX - 1; ++i)
                 {
-                    // remove the first element of the array,
-                    // shift all elements down by one, and insert the new element
-                    // at the end of the array
-                    for (size_t i = 0; i < F_MAX - 1; ++i)
-                    {
-                        pmf[x][y].features[i].pixelValue = pmf[x][y].features[i + 1].pixelValue;
-                        pmf[x][y].features[i].probability = pmf[x][y].features[i + 1].probability;
-                    }
-                    pmf[x][y].features[F_MAX - 1].pixelValue = pixelValue;
-                    pmf[x][y].features[F_MAX - 1].probability = 1.0f;
+                    pmf[s].features[i].pixelValue = pmf[s].features[i + 1].pixelValue;
+                    pmf[s].features[i].probability = pmf[s].features[i + 1].probability;
                 }
+                pmf[s].features[F_MAX - 1].pixelValue = pixelValue;
+                pmf[s].features[F_MAX - 1].probability = 1.0f;
             }
         }
     }
@@ -262,50 +831,49 @@ void GMGBackgroundSubtractor<T, X, Y, F_MAX>::train(void)
     if (_frameNum == _numInitialisationFrames - 1)
     {
         float total;
-        for (size_t x = 0; x < X; ++x)
+        for (size_t s = _rowSlotBegin[rowBegin]; s < _rowSlotBegin[rowEnd]; ++s)
         {
-            for (size_t y = 0; y < Y; ++y)
+            total = 0.0f;
+            for (size_t i = 0; i < pmf[s].featureCount; ++i)
             {
-                total = 0.0f;
-                for (size_t i = 0; i < pmf[x][y].featureCount; ++i)
-                {
-                    total += pmf[x][y].features[i].probability;
-                }
-                if (total != 0.0f)
+                total += pmf[s].features[i].probability;
+            }
+            if (total != 0.0f)
+            {
+                for (size_t i = 0; i < pmf[s].featureCount; ++i)
                 {
-                    for (size_t i = 0; i < pmf[x][y].featureCount; ++i)
-                    {
-                        pmf[x][y].features[i].probability /= total;
-                    }
+                    pmf[s].features[i].probability /= total;
                 }
             }
         }
     }
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::printFeatures()
+#if defined(ARDUINO)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::printFeatures()
 {
     Serial.printf("====== FEATURES AT FRAME %d======\n\n", _frameNum);
     for (size_t y = 0; y < Y; ++y)
     {
-        for (size_t x = 0; x < X; ++x)
+        for (size_t s = _rowSlotBegin[y]; s < _rowSlotBegin[y + 1]; ++s)
         {
-            Serial.printf("(%d, %d)", x, y);
+            Serial.printf("(%d, %d)", _slotPixel[s] - y * X, y);
             Serial.print("\t\t\t");
         }
         Serial.println();
         for (size_t i = 0; i < F_MAX; ++i)
         {
             bool isFeatureToPrint = false;
-            for (size_t x = 0; x < X; ++x)
+            for (size_t s = _rowSlotBegin[y]; s < _rowSlotBegin[y + 1]; ++s)
             {
-                if (pmf[x][y].featureCount > i)
+                const PMF &model = pmf[s];
+                if (model.featureCount > i)
                 {
                     isFeatureToPrint = true;
                     Serial.printf("%02d, %.2f\t\t",
-                                  pmf[x][y].features[i].pixelValue,
-                                  pmf[x][y].features[i].probability);
+                                  model.features[i].pixelValue,
+                                  model.features[i].probability);
                 }
                 else
                 {
@@ -320,119 +888,237 @@ void GMGBackgroundSubtractor<T, X, Y, F_MAX>::printFeatures()
         }
     }
 }
+#endif
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::updateQuantisedImage(T *src)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::updateQuantisedImage(T *src, size_t rowBegin, size_t rowEnd)
 {
-    for (size_t x = 0; x < X; ++x)
+    for (size_t s = _rowSlotBegin[rowBegin]; s < _rowSlotBegin[rowEnd]; ++s)
     {
-        for (size_t y = 0; y < Y; ++y)
+        _quantisedImage[s] = quantize(src[_slotPixel[s]]);
+    }
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+float GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::foregroundPosterior(float pPixelGivenBackground) const
+{
+    float pPixelGivenForeground = 1.0f - pPixelGivenBackground;
+    float pBackgroundGivenPixel = (pPixelGivenBackground * _params.backgroundPrior) / (pPixelGivenBackground * _params.backgroundPrior + pPixelGivenForeground * _params.foregroundPrior);
+    return 1.0f - pBackgroundGivenPixel;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::foldPendingUpdates(size_t s)
+{
+    GateState &gate = _gate[s];
+    if (gate.valid && gate.pendingDecay < 1.0f)
+    {
+        PMF &model = pmf[s];
+        for (size_t i = 0; i < model.featureCount; ++i)
         {
-            _quantisedImage[x][y] = quantize(src[y * Y + x], _minVal, _maxVal, _quantisationLevels);
+            model.features[i].probability *= gate.pendingDecay;
         }
+        model.features[gate.bin].probability = gate.binProbability;
     }
+    gate.pendingDecay = 1.0f;
+    gate.valid = false;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::updateGate(size_t s)
+{
+    GateState &gate = _gate[s];
+    float scale = 1.0f / gate.total;
+    float decay = _params.decay * scale;
+    float learningRate = _params.learningRate * scale;
+    gate.binProbability = decay * gate.binProbability + learningRate;
+    gate.pendingDecay *= decay;
+    gate.total = decay * gate.total + learningRate;
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::updatePosteriorImage(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::updatePosteriorImage(size_t rowBegin, size_t rowEnd)
 {
-    for (size_t x = 0; x < X; ++x)
+    const size_t blocksPerRow = (X + _blockSize - 1) / _blockSize;
+
+    for (size_t y = rowBegin; y < rowEnd; ++y)
     {
-        for (size_t y = 0; y < Y; ++y)
+        uint32_t fastPathCount = 0;
+        uint32_t blockCount = 0;
+        const bool *block = _blockMask != nullptr ? _blockMask + (y / _blockSize) * blocksPerRow : nullptr;
+        size_t blockEnd = _blockSize; // first column past the current block
+        for (size_t s = _rowSlotBegin[y]; s < _rowSlotBegin[y + 1]; ++s)
         {
-            uint8_t pixelValue = _quantisedImage[x][y];
+            size_t p = _slotPixel[s];
+            uint8_t pixelValue = _quantisedImage[s];
+            GateState &gate = _gate[s];
+
+            // Outside the flagged blocks the pixel is background without scoring it. If its value
+            // is unchanged the model update goes through the gating cache, otherwise it is left
+            // to the full histogram update.
+            if (block != nullptr)
+            {
+                for (size_t x = p - y * X; x >= blockEnd; blockEnd += _blockSize)
+                {
+                    block++;
+                }
+            }
+            if (block != nullptr && !*block)
+            {
+                _posteriorImage[p] = 0.0f;
+                _rawBinaryImage[p] = false;
+                if (gate.valid && pmf[s].features[gate.bin].pixelValue == pixelValue)
+                {
+                    updateGate(s);
+                    gate.fastPath = true;
+                    blockCount++;
+                }
+                else
+                {
+                    gate.fastPath = false;
+                    foldPendingUpdates(s);
+                }
+                continue;
+            }
+
+            // Fast path: same bin as last frame and background last frame. The full update would
+            // only raise this bin's weight and decay the others, so keep the former in the cache
+            // and accumulate the latter until the pixel next needs the full model.
+            if (_changeGating && gate.valid && !_binaryImage[p] &&
+                pmf[s].features[gate.bin].pixelValue == pixelValue &&
+                gate.binProbability >= _params.likelihoodThreshold)
+            {
+                _posteriorImage[p] = foregroundPosterior(gate.binProbability);
+                _rawBinaryImage[p] = false;
+                updateGate(s);
+                gate.fastPath = true;
+                fastPathCount++;
+                continue;
+            }
+            gate.fastPath = false;
+            foldPendingUpdates(s);
 
             // Attempt to find the pixel value in the model,
             // if it is not present, then 0.0f
             float pPixelGivenBackground = 0.0f;
-            for (size_t i = 0; i < pmf[x][y].featureCount; ++i)
+            for (size_t i = 0; i < pmf[s].featureCount; ++i)
             {
-                if (pmf[x][y].features[i].pixelValue == pixelValue)
+                if (pmf[s].features[i].pixelValue == pixelValue)
                 {
-                    pPixelGivenBackground = pmf[x][y].features[i].probability;
+                    pPixelGivenBackground = pmf[s].features[i].probability;
                     break;
                 }
             }
 
-            // Use Bayes' theorem to calculate the posterior probability
-            float pPixelGivenForeground = 1.0f - pPixelGivenBackground;
-            float foregroundPrior = 1.0f - _backgroundPrior;
-            float pBackgroundGivenPixel = (pPixelGivenBackground * _backgroundPrior) / (pPixelGivenBackground * _backgroundPrior + pPixelGivenForeground * foregroundPrior);
-            float pForegroundGivenPixel = 1.0f - pBackgroundGivenPixel;
-
-            // Update the posterior image
-            _posteriorImage[x][y] = pForegroundGivenPixel;
-        }
-    }
-}
-
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::updateBinaryImage(void)
-{
-    for (size_t x = 0; x < X; ++x)
-    {
-        for (size_t y = 0; y < Y; ++y)
-        {
-            _binaryImage[x][y] = _posteriorImage[x][y] > _decisionThreshold;
+            // Update the posterior image and the decision, which is equivalent to
+            // _posteriorImage[p] > decisionThreshold
+            _posteriorImage[p] = foregroundPosterior(pPixelGivenBackground);
+            _rawBinaryImage[p] = pPixelGivenBackground < _params.likelihoodThreshold;
         }
+        _rowStats[y].fastPathCount = fastPathCount;
+        _rowStats[y].blockCount = blockCount;
     }
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::smoothPosteriorImage(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::smoothPosteriorImage(void)
 {
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::smoothBinaryImage(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::smoothBinaryImage(size_t rowBegin, size_t rowEnd)
 {
-    for (size_t x = 0; x < X; ++x)
+    for (size_t y = rowBegin; y < rowEnd; ++y)
     {
-        for (size_t y = 0; y < Y; ++y)
+        // columns [segmentBegin, segmentEnd) of the current segment, the whole row by default
+        size_t segmentBegin = 0;
+        size_t segmentEnd = _smoothingWidth;
+        for (size_t s = _rowSlotBegin[y]; s < _rowSlotBegin[y + 1]; ++s)
         {
+            size_t p = _slotPixel[s];
+            size_t column = p - y * X;
+            while (column >= segmentEnd)
+            {
+                segmentBegin = segmentEnd;
+                segmentEnd += _smoothingWidth;
+            }
             // if no neighbouring pixles are foreground, then the pixel is background
             // i.e. mask with
             // 0 1 0
             // 1 0 1
             // 0 1 0
-            _binaryImage[x][y] = _binaryImage[x][y] && (((x > 0) ? _binaryImage[x - 1][y] : false) ||
-                                                        ((x < X - 1) ? _binaryImage[x + 1][y] : false) ||
-                                                        ((y > 0) ? _binaryImage[x][y - 1] : false) ||
-                                                        ((y < Y - 1) ? _binaryImage[x][y + 1] : false));
+            _binaryImage[p] = _rawBinaryImage[p] && (((column > segmentBegin) ? _rawBinaryImage[p - 1] : false) ||
+                                                     ((column + 1 < segmentEnd && column < X - 1) ? _rawBinaryImage[p + 1] : false) ||
+                                                     ((y > 0) ? _rawBinaryImage[p - X] : false) ||
+                                                     ((y < Y - 1) ? _rawBinaryImage[p + X] : false));
         }
     }
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::updateHistogram(void)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::updateHistogram(size_t rowBegin, size_t rowEnd)
 {
-    for (size_t x = 0; x < X; ++x)
+    for (size_t y = rowBegin; y < rowEnd; ++y)
     {
-        for (size_t y = 0; y < Y; ++y)
+        uint32_t learnCount = 0;
+
+        // Both schedules only depend on the frame and the slot, so tiling does not change them.
+        // Round robin visits the slots s with (s + frame) % stride == 0 directly. Random sampling
+        // visits every slot and draws from a generator seeded by the frame and row.
+        bool random = _updateStride > 1 && _updateSchedule == GMG_UPDATE_RANDOM;
+        size_t step = random ? 1 : _updateStride;
+        size_t first = _rowSlotBegin[y];
+        if (!random)
+        {
+            first += (size_t)((_updateStride - (first + _frameNum) % _updateStride) % _updateStride);
+        }
+        uint32_t state = (uint32_t)_frameNum * 0x9E3779B9u + (uint32_t)y * 0x85EBCA6Bu;
+        state ^= state >> 16;
+        state *= 0x7FEB352Du;
+        state ^= state >> 15;
+        state |= 1;
+
+        for (size_t s = first; s < _rowSlotBegin[y + 1]; s += step)
         {
-            // don't update if the pixel has been identified as foreground
-            if (_binaryImage[x][y])
+            if (random)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                if (state >= _sampleThreshold)
+                {
+                    continue;
+                }
+            }
+
+            size_t p = _slotPixel[s];
+
+            // don't update if the pixel has been identified as foreground,
+            // or if the change-gated fast path has already updated it
+            if (_binaryImage[p] || _gate[s].fastPath)
             {
                 continue;
             }
+            learnCount++;
 
-            uint8_t pixelValue = _quantisedImage[x][y];
+            PMF &model = pmf[s];
+            uint8_t pixelValue = _quantisedImage[s];
             bool present = false;
             float total = 0.0f;
             float minProbability = 1.0f;
             size_t minIndex = 0;
 
             // find the minimum weight and check whether the current pixel value is present
-            for (size_t i = 0; i < pmf[x][y].featureCount; ++i)
+            for (size_t i = 0; i < model.featureCount; ++i)
             {
-                total += pmf[x][y].features[i].probability;
-                if (pmf[x][y].features[i].probability < minProbability)
+                total += model.features[i].probability;
+                if (model.features[i].probability < minProbability)
                 {
-                    minProbability = pmf[x][y].features[i].probability;
+                    minProbability = model.features[i].probability;
                     minIndex = i;
                 }
 
-                if (pmf[x][y].features[i].pixelValue == pixelValue)
+                if (model.features[i].pixelValue == pixelValue)
                 {
                     present = true;
                 }
@@ -443,50 +1129,290 @@ void GMGBackgroundSubtractor<T, X, Y, F_MAX>::updateHistogram(void)
             // or by adding it to the histogram
             if (!present)
             {
-                if (pmf[x][y].featureCount < F_MAX)
+                if (model.featureCount < F_MAX)
                 {
-                    pmf[x][y].features[pmf[x][y].featureCount].pixelValue = pixelValue;
-                    pmf[x][y].featureCount++;
+                    model.features[model.featureCount].pixelValue = pixelValue;
+                    model.featureCount++;
                 }
                 else
                 {
-                    pmf[x][y].features[minIndex].pixelValue = pixelValue;
-                    pmf[x][y].features[minIndex].probability = 0.0f;
+                    model.features[minIndex].pixelValue = pixelValue;
+                    model.features[minIndex].probability = 0.0f;
                     total -= minProbability;
                 }
             }
 
             // update the histogram weights
             float newProbability;
-            for (size_t i = 0; i < pmf[x][y].featureCount; ++i)
+            float decay = _scheduledDecay / total;
+            float learningRate = _scheduledLearningRate / total;
+            float newTotal = 0.0f;
+            for (size_t i = 0; i < model.featureCount; ++i)
             {
-                newProbability = pmf[x][y].features[i].pixelValue == pixelValue ? 1.0f : 0.0f;
+                newProbability = model.features[i].pixelValue == pixelValue ? 1.0f : 0.0f;
+
+                model.features[i].probability =
+                    decay * model.features[i].probability +
+                    learningRate * newProbability;
+                newTotal += model.features[i].probability;
 
-                pmf[x][y].features[i].probability =
-                    ((1.0f - _learningRate) * pmf[x][y].features[i].probability +
-                     _learningRate * newProbability) /
-                    total;
+                // remember where this value lives for the change-gated fast path
+                if (newProbability != 0.0f)
+                {
+                    _gate[s].bin = (uint8_t)i;
+                    _gate[s].binProbability = model.features[i].probability;
+                    _gate[s].valid = true;
+                }
             }
+            _gate[s].total = newTotal;
         }
+        _rowStats[y].learnCount = learnCount;
     }
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-void GMGBackgroundSubtractor<T, X, Y, F_MAX>::update(T *src)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::adaptUpdateStride(uint32_t detectMicros, uint32_t learnMicros)
 {
-    updateQuantisedImage(src);
-    if (_frameNum < _numInitialisationFrames)
+    uint32_t cachedCount = 0;
+    uint32_t learnCount = 0;
+    for (size_t y = 0; y < Y; ++y)
+    {
+        cachedCount += _rowStats[y].fastPathCount + _rowStats[y].blockCount;
+        learnCount += _rowStats[y].learnCount;
+    }
+    // pixels that would have had a full model update at stride 1
+    size_t candidateCount = getNumActivePixels() - cachedCount - _foregroundCount;
+
+    // smooth the timings over a few frames so one slow frame does not swing the stride
+    _detectMicros = _detectMicros > 0.0f ? 0.75f * _detectMicros + 0.25f * detectMicros : (float)detectMicros;
+    if (learnCount > 0)
     {
-        train();
+        float perPixel = (float)learnMicros / learnCount;
+        _learnMicrosPerPixel = _learnMicrosPerPixel > 0.0f ? 0.75f * _learnMicrosPerPixel + 0.25f * perPixel : perPixel;
+    }
+
+    // smallest stride whose share of the candidates can be updated in the time left
+    float available = (float)_updateBudget - _detectMicros;
+    float needed = candidateCount * _learnMicrosPerPixel;
+    size_t stride = MAX_UPDATE_STRIDE;
+    if (needed <= available)
+    {
+        stride = 1;
+    }
+    else if (available > 0.0f && needed < available * MAX_UPDATE_STRIDE)
+    {
+        stride = (size_t)(needed / available) + 1;
+    }
+    // at most double per frame, so a single late frame can not send the stride to the limit
+    _updateStride = stride > 2 * _updateStride ? 2 * _updateStride : stride;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+uint32_t GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::nowMicros(void)
+{
+#if defined(ARDUINO)
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::processRows(size_t rowBegin, size_t rowEnd)
+{
+    updateQuantisedImage(_src, rowBegin, rowEnd);
+    if (_training)
+    {
+        train(rowBegin, rowEnd);
     }
     else
     {
-        updatePosteriorImage();
+        updatePosteriorImage(rowBegin, rowEnd);
+    }
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::finishRows(size_t rowBegin, size_t rowEnd)
+{
+    if (!_training)
+    {
         // smoothPosteriorImage();
-        updateBinaryImage();
-        smoothBinaryImage();
-        updateHistogram();
+        smoothBinaryImage(rowBegin, rowEnd);
+        updateHistogram(rowBegin, rowEnd);
     }
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::updateResults(void)
+{
+    _numChangedPixels = 0;
+    _foregroundCount = 0;
+    _boundingBox = FGBoundingBox{X, Y, 0, 0};
+
+    for (size_t byte = 0; byte < PACKED_MASK_BYTES; ++byte)
+    {
+        size_t first = byte * 8;
+        size_t last = first + 8 < X * Y ? first + 8 : X * Y;
+
+        uint8_t packed = 0;
+        for (size_t p = first; p < last; ++p)
+        {
+            packed |= (uint8_t)(_binaryImage[p] << (p - first));
+        }
+
+        // only the foreground and changed bits need visiting individually
+        uint8_t changed = packed ^ _packedMask[byte];
+        _packedMask[byte] = packed;
+        _foregroundCount += __builtin_popcount(packed);
+
+        for (uint8_t bits = packed | changed; bits != 0; bits &= bits - 1)
+        {
+            size_t p = first + __builtin_ctz(bits);
+            if (_binaryImage[p])
+            {
+                size_t x = p % X;
+                size_t y = p / X;
+                _boundingBox.xMin = x < _boundingBox.xMin ? x : _boundingBox.xMin;
+                _boundingBox.xMax = x > _boundingBox.xMax ? x : _boundingBox.xMax;
+                _boundingBox.yMin = y < _boundingBox.yMin ? y : _boundingBox.yMin;
+                _boundingBox.yMax = y > _boundingBox.yMax ? y : _boundingBox.yMax;
+            }
+            if (changed & (bits & -bits))
+            {
+                _changedPixels[_numChangedPixels++] = (uint32_t)p;
+            }
+        }
+    }
+
+    if (_changeCallback != nullptr)
+    {
+        for (size_t i = 0; i < _numChangedPixels; ++i)
+        {
+            _changeCallback(_changeCallbackContext, _changedPixels[i], _binaryImage[_changedPixels[i]]);
+        }
+    }
+}
+
+#if defined(GMG_ENABLE_THREADS)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+size_t GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::tileRows(void) const
+{
+    if (_tileRows != 0)
+    {
+        return _tileRows;
+    }
+    size_t rows = GMG_TILE_BYTES / (X * sizeof(PMF));
+    return rows == 0 ? 1 : rows;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::processTile(void *context, size_t tile)
+{
+    GMGBackgroundSubtractor *self = static_cast<GMGBackgroundSubtractor *>(context);
+    size_t rows = self->tileRows();
+    size_t rowBegin = tile * rows;
+    self->processRows(rowBegin, rowBegin + rows < Y ? rowBegin + rows : Y);
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::finishTile(void *context, size_t tile)
+{
+    GMGBackgroundSubtractor *self = static_cast<GMGBackgroundSubtractor *>(context);
+    size_t rows = self->tileRows();
+    size_t rowBegin = tile * rows;
+    self->finishRows(rowBegin, rowBegin + rows < Y ? rowBegin + rows : Y);
+}
+#endif
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::update(T *src, const bool *blockMask, size_t blockSize)
+{
+    // without a block size there are no blocks to skip, so score every pixel
+    if (blockMask == nullptr || blockSize == 0)
+    {
+        update(src);
+        return;
+    }
+
+    _blockMask = blockMask;
+    _blockSize = blockSize;
+    update(src);
+    _blockMask = nullptr;
+    _blockSize = 1;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+void GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::update(T *src)
+{
+    _src = src;
+    _training = _frameNum < _numInitialisationFrames;
+    applyStagedParams();
+
+    // each pixel is updated about once per stride frames, so it takes stride steps of the EMA at once,
+    // as many as fit under the learning rate cap
+    _scheduledDecay = _params.decay;
+    _scheduledLearningRate = _params.learningRate;
+    if (_updateStride > 1)
+    {
+        for (size_t i = 1; i < _updateStride && 1.0f - _scheduledDecay * _params.decay <= MAX_SCHEDULED_LEARNING_RATE; ++i)
+        {
+            _scheduledDecay *= _params.decay;
+        }
+        _scheduledLearningRate = 1.0f - _scheduledDecay;
+        _sampleThreshold = (uint32_t)(0xFFFFFFFFu / _updateStride);
+    }
+
+    bool timed = _updateBudget != 0 && !_training;
+    uint32_t start = timed ? nowMicros() : 0;
+    uint32_t detected = start;
+
+#if defined(GMG_ENABLE_THREADS)
+    if (_threadPool != nullptr)
+    {
+        size_t rows = tileRows();
+        size_t numTiles = (Y + rows - 1) / rows;
+        // smoothing reads the neighbouring rows of other tiles, so every tile must have
+        // made its raw decisions before any tile is smoothed
+        _threadPool->run(numTiles, &processTile, this);
+        if (!_training)
+        {
+            // smoothing is timed with the model update here, which errs on the side of a larger stride
+            detected = timed ? nowMicros() : 0;
+            _threadPool->run(numTiles, &finishTile, this);
+        }
+    }
+    else
+#endif
+    {
+        processRows(0, Y);
+        if (!_training)
+        {
+            smoothBinaryImage(0, Y);
+            detected = timed ? nowMicros() : 0;
+            updateHistogram(0, Y);
+        }
+    }
+
+    if (!_training)
+    {
+        uint32_t learned = timed ? nowMicros() : 0;
+        updateResults();
+
+        uint32_t fastPathCount = 0;
+        for (size_t y = 0; y < Y; ++y)
+        {
+            fastPathCount += _rowStats[y].fastPathCount;
+        }
+        _fastPathFraction = getNumActivePixels() > 0 ? (float)fastPathCount / getNumActivePixels() : 0.0f;
+
+        if (timed)
+        {
+            adaptUpdateStride((detected - start) + (nowMicros() - learned), learned - detected);
+        }
+    }
+
+    _src = nullptr;
     _frameNum++;
     // if (_frameNum % _numInitialisationFrames == 0)
     // {
@@ -494,14 +1420,24 @@ void GMGBackgroundSubtractor<T, X, Y, F_MAX>::update(T *src)
     // }
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-FGResult GMGBackgroundSubtractor<T, X, Y, F_MAX>::isFG(size_t idx)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+FGResult GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::isFG(size_t idx)
 {
-    return FGResult{_binaryImage[idx % X][idx / Y], _posteriorImage[idx % X][idx / Y]};
+    return FGResult{_binaryImage[idx], _posteriorImage[idx]};
 }
 
-template <typename T, size_t X, size_t Y, size_t F_MAX>
-FGResult GMGBackgroundSubtractor<T, X, Y, F_MAX>::isFG(size_t x, size_t y)
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX, typename CONFIG, typename STORAGE>
+FGResult GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, STORAGE>::isFG(size_t x, size_t y)
 {
-    return FGResult{_binaryImage[x][y], _posteriorImage[x][y]};
+    return FGResult{_binaryImage[y * X + x], _posteriorImage[y * X + x]};
 }
+
+// GMGBackgroundSubtractor over every pixel with model parameters fixed at compile time.
+// @tparam CONFIG A struct of compile-time parameters as described in GMGConfig.h.
+template <typename T, size_t X, size_t Y, size_t F_MAX, typename CONFIG>
+using FixedGMGBackgroundSubtractor = GMGBackgroundSubtractor<T, X, Y, F_MAX, X * Y, CONFIG>;
+
+// GMGBackgroundSubtractor whose image buffers are declared separately and given to its constructor,
+// so that the model and the images can be placed in different memories. See GMGMemory.h.
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX = X * Y, typename CONFIG = GMGRuntimeConfig>
+using SplitGMGBackgroundSubtractor = GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX, CONFIG, GMGExternalImages>;
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+
+// Model parameters of GMGBackgroundSubtractor, either settable at runtime (the default) or fixed
+// at compile time for deployments that never change them.
+//
+// A fixed configuration is a struct with the four parameters as static constexpr members, e.g.
+//
+//     struct GridEYEConfig
+//     {
+//         static constexpr uint16_t quantisationLevels = 32;
+//         static constexpr float backgroundPrior = 0.8f;
+//         static constexpr float learningRate = 0.025f;
+//         static constexpr float decisionThreshold = 0.9f;
+//     };
+//     FixedGMGBackgroundSubtractor<float, 8, 8, 32, GridEYEConfig> gmg_bg_subtractor;
+//
+// The subtractor reads its parameters and the values derived from them through GMGParams, so with
+// a fixed configuration they are all constants the compiler can fold into the per-pixel loops.
+//
+// A pixel is foreground when its posterior is over the decision threshold. The posterior only
+// falls as the pixel's weight in the background model rises, so the same decision can be made by
+// comparing that weight with likelihoodThreshold, which saves the per-pixel Bayes' rule:
+//
+//     P(FG | v) > t  <=>  P(v | BG) < (1 - t) P(FG) / (t P(BG) + (1 - t) P(FG))
+
+// @brief The background weight under which a pixel is foreground, see above
+constexpr float gmgLikelihoodThreshold(float backgroundPrior, float decisionThreshold)
+{
+    return backgroundPrior * decisionThreshold + (1.0f - decisionThreshold) * (1.0f - backgroundPrior) > 0.0f
+               ? (1.0f - decisionThreshold) * (1.0f - backgroundPrior) /
+                     (backgroundPrior * decisionThreshold + (1.0f - decisionThreshold) * (1.0f - backgroundPrior))
+               : 0.0f; // the posterior can not exceed the threshold
+}
+
+// Selects runtime-settable parameters. This is the default configuration.
+struct GMGRuntimeConfig
+{
+};
+
+// Fixed configuration with the same values as the runtime defaults.
+struct GMGDefaultConfig
+{
+    static constexpr uint16_t quantisationLevels = 32;
+    static constexpr float backgroundPrior = 0.8f;
+    static constexpr float learningRate = 0.025f;
+    static constexpr float decisionThreshold = 0.9f;
+};
+
+// Parameters and derived values for a fixed configuration, all compile-time constants.
+template <typename CONFIG>
+struct GMGParams
+{
+    static constexpr bool IS_RUNTIME = false;
+
+    static constexpr uint16_t quantisationLevels = CONFIG::quantisationLevels;
+    static constexpr float backgroundPrior = CONFIG::backgroundPrior;
+    static constexpr float learningRate = CONFIG::learningRate;
+    static constexpr float decisionThreshold = CONFIG::decisionThreshold;
+
+    // derived values
+    static constexpr float foregroundPrior = 1.0f - backgroundPrior;
+    static constexpr float decay = 1.0f - learningRate;
+    static constexpr float maxLevel = (float)(quantisationLevels - 1);
+    static constexpr float likelihoodThreshold = gmgLikelihoodThreshold(backgroundPrior, decisionThreshold);
+
+    static_assert(quantisationLevels >= 2 && quantisationLevels <= 256, "quantisationLevels must be in [2, 256]");
+
+    void derive(void) {}
+};
+
+// Parameters and derived values settable at runtime. derive() must be called after changing them.
+template <>
+struct GMGParams<GMGRuntimeConfig>
+{
+    static constexpr bool IS_RUNTIME = true;
+
+    uint16_t quantisationLevels;
+    float backgroundPrior;
+    float learningRate;
+    float decisionThreshold;
+
+    // derived values
+    float foregroundPrior;
+    float decay;
+    float maxLevel;
+    float likelihoodThreshold;
+
+    GMGParams(void)
+    {
+        // default values
+        quantisationLevels = GMGDefaultConfig::quantisationLevels;
+        backgroundPrior = GMGDefaultConfig::backgroundPrior;
+        learningRate = GMGDefaultConfig::learningRate;
+        decisionThreshold = GMGDefaultConfig::decisionThreshold;
+        derive();
+    }
+
+    // @brief Recompute the derived values from the parameters
+    void derive(void)
+    {
+        foregroundPrior = 1.0f - backgroundPrior;
+        decay = 1.0f - learningRate;
+        maxLevel = (float)(quantisationLevels - 1);
+        likelihoodThreshold = gmgLikelihoodThreshold(backgroundPrior, decisionThreshold);
+    }
+};
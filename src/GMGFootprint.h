@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "GMGBackgroundSubtractor.h"
+
+// Compile-time memory footprint of a GMGBackgroundSubtractor configuration, with budgets checked
+// by static_assert so that a configuration that would not fit fails to build rather than to link
+// or run. Give the configuration a name first, as macro arguments can not contain commas:
+//
+//     typedef SplitGMGBackgroundSubtractor<float, 32, 24, 32> Subtractor;
+//     GMG_FOOTPRINT_BUDGET(Subtractor, 256 * 1024, 16 * 1024);
+//
+//     GMG_OCRAM Subtractor::ImageBuffers gmg_images;
+//     GMG_DTCM Subtractor gmg_bg_subtractor(gmg_images);
+//
+// The sizes can also be read directly, e.g. GMGFootprint<Subtractor>::MODEL_BYTES.
+// @tparam SUBTRACTOR A GMGBackgroundSubtractor type.
+template <typename SUBTRACTOR>
+struct GMGFootprint
+{
+    static constexpr bool EXTERNAL_IMAGES = SUBTRACTOR::Storage::EXTERNAL;
+
+    // @brief The per-pixel model, part of the object
+    static constexpr size_t MODEL_BYTES = SUBTRACTOR::getModelBytes();
+
+    // @brief The image buffers, part of the object unless they are external
+    static constexpr size_t IMAGE_BYTES = SUBTRACTOR::getImageBytes();
+
+    // @brief The object, which goes wherever it is declared
+    static constexpr size_t OBJECT_BYTES = sizeof(SUBTRACTOR);
+
+    // @brief The separately declared image buffers of a split subtractor
+    static constexpr size_t EXTERNAL_BYTES = EXTERNAL_IMAGES ? IMAGE_BYTES : 0;
+
+    // @brief Everything in the object besides the model and images: per-row counters and scalars
+    static constexpr size_t OTHER_BYTES = OBJECT_BYTES - MODEL_BYTES - (EXTERNAL_IMAGES ? 0 : IMAGE_BYTES);
+
+    static constexpr size_t TOTAL_BYTES = OBJECT_BYTES + EXTERNAL_BYTES;
+};
+
+// @brief Fail to compile if a configuration is over budget
+// @param SUBTRACTOR A GMGBackgroundSubtractor type, without commas
+// @param OBJECT_BUDGET Bytes available for the object, e.g. in DTCM
+// @param EXTERNAL_BUDGET Bytes available for its external image buffers, e.g. in OCRAM
+#define GMG_FOOTPRINT_BUDGET(SUBTRACTOR, OBJECT_BUDGET, EXTERNAL_BUDGET)                              \
+    static_assert(GMGFootprint<SUBTRACTOR>::OBJECT_BYTES <= (OBJECT_BUDGET),                          \
+                  #SUBTRACTOR " is over its object budget");                                         \
+    static_assert(GMGFootprint<SUBTRACTOR>::EXTERNAL_BYTES <= (EXTERNAL_BUDGET),                      \
+                  #SUBTRACTOR " is over its image buffer budget")
+
+#if defined(GMG_DTCM_BYTES)
+// @brief Fail to compile if a configuration does not fit the Teensy 4 memories at all. Code and
+// other globals share DTCM, so a real sketch should also set a tighter budget of its own.
+#define GMG_TEENSY4_BUDGET(SUBTRACTOR) GMG_FOOTPRINT_BUDGET(SUBTRACTOR, GMG_DTCM_BYTES, GMG_OCRAM_BYTES)
+#endif
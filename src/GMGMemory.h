@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memory placement of GMGBackgroundSubtractor's storage.
+//
+// The subtractor's state splits into the per-pixel model, which every update searches and rewrites
+// several times per pixel, and the full-size images, which are written once per pixel and mostly
+// read by whatever consumes the results. On a Teensy 4.x ordinary globals live in DTCM, which the
+// core reads without wait states, while DMAMEM globals live in the slower, cached OCRAM. Both are
+// 512KB, so larger configurations only fit with the images moved out to OCRAM:
+//
+//     GMG_OCRAM GMGImageBuffers<32, 24> gmg_images;
+//     GMG_DTCM SplitGMGBackgroundSubtractor<float, 32, 24, 32> gmg_bg_subtractor(gmg_images);
+//
+// GMGFootprint.h reports the resulting sizes at compile time and checks them against budgets.
+
+#if defined(__IMXRT1062__)
+// Teensy 4.0 / 4.1. DTCM is the default for globals; it shares its 512KB with code in ITCM.
+#define GMG_DTCM
+#define GMG_OCRAM DMAMEM
+#define GMG_DTCM_BYTES (512 * 1024)
+#define GMG_OCRAM_BYTES (512 * 1024)
+#else
+// One kind of memory, nothing to place.
+#define GMG_DTCM
+#define GMG_OCRAM
+#endif
+
+// The full-size images of a subtractor, row-major, one entry per pixel of the X * Y input.
+template <size_t X, size_t Y>
+struct GMGImageBuffers
+{
+    float posteriorImage[X * Y];        // Probability of each pixel being foreground
+    bool rawBinaryImage[X * Y];         // Foreground decisions before smoothing
+    bool binaryImage[X * Y];            // Foreground decisions after smoothing
+    uint8_t packedMask[(X * Y + 7) / 8]; // binaryImage packed 8 pixels per byte
+    uint32_t changedPixels[X * Y];      // Pixels whose decision changed in the last update
+};
+
+// Keeps the image buffers inside the subtractor object. This is the default.
+struct GMGInternalImages
+{
+    static const bool EXTERNAL = false;
+
+    template <size_t X, size_t Y>
+    struct Holder
+    {
+        GMGImageBuffers<X, Y> buffers;
+        GMGImageBuffers<X, Y> *get(void) { return &buffers; }
+    };
+};
+
+// The image buffers are declared separately and given to the subtractor's constructor, so they
+// can be placed in a different memory from the model.
+struct GMGExternalImages
+{
+    static const bool EXTERNAL = true;
+
+    template <size_t X, size_t Y>
+    struct Holder
+    {
+        GMGImageBuffers<X, Y> *get(void) { return nullptr; }
+    };
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+// Persistent worker pool used by GMGBackgroundSubtractor's parallel mode on hosted (Linux) builds.
+// Not available on the Teensy; only compiled when GMG_ENABLE_THREADS is defined.
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that are started once and reused for every call to run().
+// run() hands out task indices [0, numTasks) to the workers and the calling thread, and returns
+// once every task has completed. No threads are created or destroyed per call.
+class GMGThreadPool
+{
+public:
+    // @brief Signature of the function executed for each task
+    // @param context Opaque pointer passed through from run()
+    // @param task Index of the task, 0 <= task < numTasks
+    typedef void (*TaskFunction)(void *context, size_t task);
+
+    // @brief Start the worker threads
+    // @param numThreads Total number of threads taking part in run(), including the caller.
+    // 0 uses the number of hardware threads.
+    explicit GMGThreadPool(size_t numThreads = 0);
+    ~GMGThreadPool(void);
+
+    GMGThreadPool(const GMGThreadPool &) = delete;
+    GMGThreadPool &operator=(const GMGThreadPool &) = delete;
+
+    // @brief Execute fn(context, task) for every task in [0, numTasks) and wait for completion.
+    // Must only be called from one thread at a time.
+    void run(size_t numTasks, TaskFunction fn, void *context);
+
+    // @brief Number of threads taking part in run(), including the caller
+    size_t getNumThreads(void) const { return _workers.size() + 1; }
+
+private:
+    // @brief Main loop of each worker thread
+    void workerLoop(void);
+
+    // @brief Claim and execute tasks of the current job until none are left
+    void drainTasks(TaskFunction fn, void *context, size_t numTasks);
+
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _jobReady;    // signalled when a new job is published
+    std::condition_variable _jobFinished; // signalled when the last active worker leaves a job
+
+    // Current job, protected by _mutex
+    TaskFunction _fn;
+    void *_context;
+    size_t _numTasks;
+    size_t _generation;     // incremented for every published job
+    size_t _activeWorkers;  // workers currently executing tasks of the job
+    bool _stop;
+
+    // Next unclaimed task index of the current job
+    std::atomic<size_t> _nextTask;
+};
+
+inline GMGThreadPool::GMGThreadPool(size_t numThreads)
+    : _fn(nullptr),
+      _context(nullptr),
+      _numTasks(0),
+      _generation(0),
+      _activeWorkers(0),
+      _stop(false),
+      _nextTask(0)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::thread::hardware_concurrency();
+    }
+    for (size_t i = 1; i < numThreads; ++i)
+    {
+        _workers.emplace_back(&GMGThreadPool::workerLoop, this);
+    }
+}
+
+inline GMGThreadPool::~GMGThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _jobReady.notify_all();
+    for (size_t i = 0; i < _workers.size(); ++i)
+    {
+        _workers[i].join();
+    }
+}
+
+inline void GMGThreadPool::run(size_t numTasks, TaskFunction fn, void *context)
+{
+    if (numTasks == 0)
+    {
+        return;
+    }
+
+    // Nothing to share the work with
+    if (_workers.empty() || numTasks == 1)
+    {
+        for (size_t task = 0; task < numTasks; ++task)
+        {
+            fn(context, task);
+        }
+        return;
+    }
+
+    {
+        // a worker that woke up late for the previous job may still be leaving it; it must not
+        // see the task counter of this job
+        std::unique_lock<std::mutex> lock(_mutex);
+        _jobFinished.wait(lock, [this] { return _activeWorkers == 0; });
+        _fn = fn;
+        _context = context;
+        _numTasks = numTasks;
+        _nextTask.store(0, std::memory_order_relaxed);
+        _generation++;
+    }
+    _jobReady.notify_all();
+
+    // the calling thread works too, then waits for any tasks still running on workers
+    drainTasks(fn, context, numTasks);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _jobFinished.wait(lock, [this] { return _activeWorkers == 0; });
+}
+
+inline void GMGThreadPool::drainTasks(TaskFunction fn, void *context, size_t numTasks)
+{
+    for (size_t task = _nextTask.fetch_add(1, std::memory_order_relaxed);
+         task < numTasks;
+         task = _nextTask.fetch_add(1, std::memory_order_relaxed))
+    {
+        fn(context, task);
+    }
+}
+
+inline void GMGThreadPool::workerLoop(void)
+{
+    size_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;)
+    {
+        _jobReady.wait(lock, [&] { return _stop || _generation != seenGeneration; });
+        if (_stop)
+        {
+            return;
+        }
+
+        // snapshot the job while holding the lock, then work on it unlocked
+        seenGeneration = _generation;
+        TaskFunction fn = _fn;
+        void *context = _context;
+        size_t numTasks = _numTasks;
+        _activeWorkers++;
+
+        lock.unlock();
+        drainTasks(fn, context, numTasks);
+        lock.lock();
+
+        if (--_activeWorkers == 0)
+        {
+            _jobFinished.notify_one();
+        }
+    }
+}
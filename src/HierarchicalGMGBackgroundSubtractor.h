@@ -0,0 +1,254 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GMGBackgroundSubtractor.h"
+
+// Two-level GMG background subtraction for high resolution inputs where foreground covers a small
+// part of the frame.
+//
+// Each frame is block-averaged down by B in each direction and run through a coarse GMG model.
+// Blocks the coarse model considers possibly foreground, grown by a margin, are scored by the
+// full resolution model; everywhere else is taken as background and only updates the full
+// resolution model, which is cheap for pixels whose value has not changed. Both models train on
+// every pixel.
+// @tparam T The type of the input image.
+// @tparam X The width of the input image.
+// @tparam Y The height of the input image.
+// @tparam F_MAX The maximum number of features in the background model for each pixel.
+// @tparam B The block size, in pixels, of the coarse level.
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t B>
+class HierarchicalGMGBackgroundSubtractor
+{
+public:
+    // @brief Size of the coarse level
+    static const size_t COARSE_X = (X + B - 1) / B;
+    static const size_t COARSE_Y = (Y + B - 1) / B;
+
+    typedef GMGBackgroundSubtractor<T, X, Y, F_MAX> FineSubtractor;
+    typedef GMGBackgroundSubtractor<T, COARSE_X, COARSE_Y, F_MAX> CoarseSubtractor;
+
+    HierarchicalGMGBackgroundSubtractor(void);
+
+    // @brief Reset both models and begin training again
+    void init(void);
+
+    // @brief Update both levels and the foreground predictions
+    // @param image The image to update the model with, row-major with X pixels per row
+    void update(T *src);
+
+    // @brief Foreground result for a pixel of the full resolution image
+    FGResult isFG(size_t idx) { return _fine.isFG(idx); }
+    FGResult isFG(size_t x, size_t y) { return _fine.isFG(x, y); }
+
+    // @brief Is the model in initial training mode?
+    bool isTraining(void) const { return _fine.isTraining(); }
+
+    // @brief The full resolution subtractor, for its results and any setting not forwarded here
+    FineSubtractor &getFine(void) { return _fine; }
+
+    // @brief The coarse subtractor
+    CoarseSubtractor &getCoarse(void) { return _coarse; }
+
+    // @brief Blocks scored at full resolution in the last update, COARSE_X per row
+    const bool *getBlockMask(void) const { return _blockMask; }
+
+    // @brief Fraction of blocks scored at full resolution in the last update
+    float getFlaggedFraction(void) const { return _flaggedFraction; }
+
+    // getters and setters, applied to both levels
+
+    void setNumInitialisationFrames(uint64_t val)
+    {
+        _fine.setNumInitialisationFrames(val);
+        _coarse.setNumInitialisationFrames(val);
+    }
+    uint64_t getNumInitialisationFrames(void) { return _fine.getNumInitialisationFrames(); }
+
+    void setMinVal(T val)
+    {
+        _fine.setMinVal(val);
+        _coarse.setMinVal(val);
+    }
+    T getMinVal(void) { return _fine.getMinVal(); }
+
+    void setMaxVal(T val)
+    {
+        _fine.setMaxVal(val);
+        _coarse.setMaxVal(val);
+    }
+    T getMaxVal(void) { return _fine.getMaxVal(); }
+
+    void setLearningRate(float val)
+    {
+        _fine.setLearningRate(val);
+        _coarse.setLearningRate(val);
+    }
+    float getLearningRate(void) { return _fine.getLearningRate(); }
+
+    void setQuantisationLevels(uint16_t val)
+    {
+        _fine.setQuantisationLevels(val);
+        _coarse.setQuantisationLevels(val);
+    }
+    uint16_t getQuantisationLevels(void) { return _fine.getQuantisationLevels(); }
+
+    void setBackgroundPrior(float val)
+    {
+        _fine.setBackgroundPrior(val);
+        _coarse.setBackgroundPrior(val);
+    }
+    float getBackgroundPrior(void) { return _fine.getBackgroundPrior(); }
+
+    // The coarse level flags blocks by setCoarseThreshold(), so this only decides at full resolution,
+    // but it is kept on both levels so that getCoarse() is a consistent model of its own.
+    void setDecisionThreshold(float val)
+    {
+        _fine.setDecisionThreshold(val);
+        _coarse.setDecisionThreshold(val);
+    }
+    float getDecisionThreshold(void) { return _fine.getDecisionThreshold(); }
+
+    // getters and setters of the coarse level
+
+    // Posterior probability over which a coarse block is flagged. Block averaging dilutes small
+    // objects, so this should be well below the full resolution decision threshold.
+    void setCoarseThreshold(float val) { _coarseThreshold = val; }
+    float getCoarseThreshold(void) { return _coarseThreshold; }
+
+    // Number of blocks by which flagged blocks are grown in every direction.
+    void setMargin(size_t val) { _margin = val; }
+    size_t getMargin(void) { return _margin; }
+
+private:
+    // @brief Average each B x B block of the input into the coarse image
+    void downsample(const T *src);
+
+    // @brief Flag the blocks to score at full resolution from the coarse posterior
+    void updateBlockMask(void);
+
+    FineSubtractor _fine;
+    CoarseSubtractor _coarse;
+
+    // @brief Block-averaged input, row-major.
+    T _coarseImage[COARSE_X * COARSE_Y];
+
+    // @brief Coarse blocks over the threshold before and after growing by the margin, row-major.
+    bool _coarseFlags[COARSE_X * COARSE_Y];
+    bool _blockMask[COARSE_X * COARSE_Y];
+
+    float _flaggedFraction;
+
+    // CHANGEABLE PARAMETERS
+    // These are given default values in the constructor. Use the setter functions to change them.
+
+    float _coarseThreshold;
+    size_t _margin;
+};
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t B>
+HierarchicalGMGBackgroundSubtractor<T, X, Y, F_MAX, B>::HierarchicalGMGBackgroundSubtractor(void)
+{
+    // default values
+    _coarseThreshold = 0.5f;
+    _margin = 1;
+
+    init();
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t B>
+void HierarchicalGMGBackgroundSubtractor<T, X, Y, F_MAX, B>::init(void)
+{
+    _fine.init();
+    _coarse.init();
+    for (size_t i = 0; i < COARSE_X * COARSE_Y; ++i)
+    {
+        _blockMask[i] = true;
+    }
+    _flaggedFraction = 1.0f;
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t B>
+void HierarchicalGMGBackgroundSubtractor<T, X, Y, F_MAX, B>::downsample(const T *src)
+{
+    // accumulate rows of blocks in float, blocks on the right and bottom edges may be partial
+    float sums[COARSE_X];
+    for (size_t by = 0; by < COARSE_Y; ++by)
+    {
+        for (size_t bx = 0; bx < COARSE_X; ++bx)
+        {
+            sums[bx] = 0.0f;
+        }
+
+        size_t yEnd = (by + 1) * B < Y ? (by + 1) * B : Y;
+        for (size_t y = by * B; y < yEnd; ++y)
+        {
+            const T *row = src + y * X;
+            for (size_t x = 0; x < X; ++x)
+            {
+                sums[x / B] += (float)row[x];
+            }
+        }
+
+        size_t rows = yEnd - by * B;
+        for (size_t bx = 0; bx < COARSE_X; ++bx)
+        {
+            size_t cols = (bx + 1) * B < X ? B : X - bx * B;
+            _coarseImage[by * COARSE_X + bx] = (T)(sums[bx] / (rows * cols));
+        }
+    }
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t B>
+void HierarchicalGMGBackgroundSubtractor<T, X, Y, F_MAX, B>::updateBlockMask(void)
+{
+    // use the coarse posterior rather than its smoothed mask, as one person may only be one block
+    const float *posterior = _coarse.getConfidenceImage();
+    for (size_t i = 0; i < COARSE_X * COARSE_Y; ++i)
+    {
+        _coarseFlags[i] = posterior[i] > _coarseThreshold;
+        _blockMask[i] = false;
+    }
+
+    size_t flagged = 0;
+    for (size_t by = 0; by < COARSE_Y; ++by)
+    {
+        for (size_t bx = 0; bx < COARSE_X; ++bx)
+        {
+            if (!_coarseFlags[by * COARSE_X + bx])
+            {
+                continue;
+            }
+            size_t yBegin = by > _margin ? by - _margin : 0;
+            size_t yEnd = by + _margin < COARSE_Y - 1 ? by + _margin : COARSE_Y - 1;
+            size_t xBegin = bx > _margin ? bx - _margin : 0;
+            size_t xEnd = bx + _margin < COARSE_X - 1 ? bx + _margin : COARSE_X - 1;
+            for (size_t y = yBegin; y <= yEnd; ++y)
+            {
+                for (size_t x = xBegin; x <= xEnd; ++x)
+                {
+                    flagged += !_blockMask[y * COARSE_X + x];
+                    _blockMask[y * COARSE_X + x] = true;
+                }
+            }
+        }
+    }
+    _flaggedFraction = (float)flagged / (COARSE_X * COARSE_Y);
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t B>
+void HierarchicalGMGBackgroundSubtractor<T, X, Y, F_MAX, B>::update(T *src)
+{
+    downsample(src);
+    _coarse.update(_coarseImage);
+
+    if (_coarse.isTraining())
+    {
+        _fine.update(src);
+        return;
+    }
+
+    updateBlockMask();
+    _fine.update(src, _blockMask, B);
+}
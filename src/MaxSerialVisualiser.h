@@ -36,10 +36,11 @@ public:
             }
             bg_subtractor->update(temp_data_buffer);
 
+            const bool *fg = bg_subtractor->getForegroundImage();
             for (int i = 0, buf_idx = 2; i < 64; i++, buf_idx+=2)
             {
                 sprintf(tempoutbuffer + buf_idx, "%d ", quantise(temp_data_buffer[i], deviceTemp * 0.85, deviceTemp * 1.25, 10));
-                sprintf(fgoutbuffer + buf_idx, "%d ", bg_subtractor->isFG(i).isFG);
+                sprintf(fgoutbuffer + buf_idx, "%d ", fg[i]);
             }
             fgoutbuffer[char_buf_len - 1] = '\n';
             tempoutbuffer[char_buf_len - 1] = '\n';
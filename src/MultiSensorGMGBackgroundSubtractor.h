@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "GMGBackgroundSubtractor.h"
+
+// Background subtraction for N identical sensors, e.g. several GridEYEs on one bus, treated as a
+// single panoramic image with the sensors side by side from left to right.
+//
+// Each row of the panorama holds row y of sensor 0, then row y of sensor 1, and so on, so the
+// models of all sensors live interleaved row by row in one GMGBackgroundSubtractor and are updated
+// by one call. The foreground mask comes out stitched the same way for later stages such as
+// BlobExtractor, alongside the stitched input from getPanoramaImage().
+//
+// By default each sensor's mask is smoothed on its own and is identical to that of a separate
+// subtractor. If the sensors' fields of view meet edge to edge, setSeamSmoothing(true) smooths
+// across the seams too, so that a person standing on one is not cut in two.
+//
+// Each sensor has its own input range. Frames are normalised to [0, 1] as floats on the way into
+// the panorama's model, which quantises exactly as a separate subtractor with that range would.
+// @tparam T The type of the input image.
+// @tparam X The width of each sensor image.
+// @tparam Y The height of each sensor image.
+// @tparam F_MAX The maximum number of features in the background model for each pixel.
+// @tparam N The number of sensors.
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t N>
+class MultiSensorGMGBackgroundSubtractor
+{
+public:
+    // @brief Width of the panorama
+    static const size_t PANORAMA_X = X * N;
+
+    // the model sees every sensor through its own range, normalised to [0, 1]
+    typedef GMGBackgroundSubtractor<float, PANORAMA_X, Y, F_MAX> PanoramaSubtractor;
+
+    MultiSensorGMGBackgroundSubtractor(void);
+
+    // @brief Reset the models of every sensor and begin training again
+    void init(void) { _panorama.init(); }
+
+    // @brief Copy a sensor's frame into the panorama and its normalised copy, ready for the next update
+    // @param sensor Index of the sensor, 0 <= sensor < N
+    // @param src The sensor's image, row-major with X pixels per row
+    void setFrame(size_t sensor, const T *src);
+
+    // @brief Update the models of all sensors with the frames given to setFrame
+    void update(void) { _panorama.update(_normalisedImage); }
+
+    // @brief Set the frames of all sensors and update
+    // @param frames N pointers to sensor images, row-major with X pixels per row
+    void update(const T *const *frames);
+
+    // @brief Foreground result for a pixel of one sensor
+    // @param sensor Index of the sensor
+    // @param idx Row-major pixel index within the sensor, i.e. y * X + x
+    FGResult isFG(size_t sensor, size_t idx) { return isFG(sensor, idx % X, idx / X); }
+    FGResult isFG(size_t sensor, size_t x, size_t y) { return _panorama.isFG(sensor * X + x, y); }
+
+    // @brief Is the model in initial training mode?
+    bool isTraining(void) const { return _panorama.isTraining(); }
+
+    // @brief The subtractor over the whole panorama, for its bulk results and model parameters.
+    // Its input range is [0, 1] and must not be changed; use setSensorRange instead.
+    PanoramaSubtractor &getPanorama(void) { return _panorama; }
+
+    // @brief The sensors' frames as given, stitched row by row with PANORAMA_X pixels per row,
+    // e.g. for BlobExtractor::update together with getPanorama().getPackedForegroundMask()
+    const T *getPanoramaImage(void) const { return _panoramaImage; }
+
+    // @brief The stitched frames normalised by each sensor's range, as given to the model
+    const float *getNormalisedImage(void) const { return _normalisedImage; }
+
+    // getters and setters
+
+    // Input range of each sensor. Values are clamped to it.
+    void setSensorRange(size_t sensor, T minVal, T maxVal)
+    {
+        _minVal[sensor] = minVal;
+        _maxVal[sensor] = maxVal;
+    }
+    T getSensorMinVal(size_t sensor) { return _minVal[sensor]; }
+    T getSensorMaxVal(size_t sensor) { return _maxVal[sensor]; }
+
+    // Smooth the mask across the seams between neighbouring sensors, for sensors whose fields of
+    // view meet edge to edge. Off by default.
+    void setSeamSmoothing(bool enabled) { _panorama.setSmoothingWidth(enabled ? PANORAMA_X : X); }
+    bool getSeamSmoothing(void) { return _panorama.getSmoothingWidth() == PANORAMA_X; }
+
+private:
+    PanoramaSubtractor _panorama;
+
+    // @brief Frames of all sensors, interleaved row by row, as given and normalised.
+    T _panoramaImage[PANORAMA_X * Y];
+    float _normalisedImage[PANORAMA_X * Y];
+
+    T _minVal[N];
+    T _maxVal[N];
+};
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t N>
+MultiSensorGMGBackgroundSubtractor<T, X, Y, F_MAX, N>::MultiSensorGMGBackgroundSubtractor(void)
+{
+    // default values
+    for (size_t i = 0; i < N; ++i)
+    {
+        _minVal[i] = 0;
+        _maxVal[i] = 1;
+    }
+    for (size_t i = 0; i < PANORAMA_X * Y; ++i)
+    {
+        _panoramaImage[i] = 0;
+        _normalisedImage[i] = 0.0f;
+    }
+
+    // the per-sensor ranges are applied in setFrame
+    _panorama.setMinVal(0.0f);
+    _panorama.setMaxVal(1.0f);
+    setSeamSmoothing(false);
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t N>
+void MultiSensorGMGBackgroundSubtractor<T, X, Y, F_MAX, N>::setFrame(size_t sensor, const T *src)
+{
+    T minVal = _minVal[sensor];
+    T maxVal = _maxVal[sensor];
+    float range = (float)(maxVal - minVal);
+    for (size_t y = 0; y < Y; ++y)
+    {
+        const T *in = src + y * X;
+        T *out = _panoramaImage + y * PANORAMA_X + sensor * X;
+        float *normalised = _normalisedImage + y * PANORAMA_X + sensor * X;
+        for (size_t x = 0; x < X; ++x)
+        {
+            out[x] = in[x];
+            // clamp and divide as GMGBackgroundSubtractor does, so that the panorama's model, with
+            // the range [0, 1], puts every value in the same bin as a separate subtractor would
+            T val = in[x] < minVal ? minVal : (in[x] > maxVal ? maxVal : in[x]);
+            normalised[x] = (val - minVal) / range;
+        }
+    }
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t N>
+void MultiSensorGMGBackgroundSubtractor<T, X, Y, F_MAX, N>::update(const T *const *frames)
+{
+    for (size_t sensor = 0; sensor < N; ++sensor)
+    {
+        setFrame(sensor, frames[sensor]);
+    }
+    update();
+}
@@ -49,6 +49,7 @@ public:
     step_y = (tft->height() - top_buffer_size) / 8;
 
     ms += refresh_rate; // force refresh
+    invalidate_fg();
     update();
   }
 
@@ -92,9 +93,19 @@ public:
     delay(500);
   }
 
+  // forget what has been drawn so the next print_fg redraws every cell
+  void invalidate_fg(void)
+  {
+    for (uint16_t i = 0; i < 8 * 8; i++)
+    {
+      drawn_valid[i] = false;
+    }
+  }
+
   void print_is_training(void)
   {
     char text[] = "TRAINING";
+    invalidate_fg();
     clear_bottom_portion();
     tft->setTextColor(ST77XX_CYAN);
     tft->setTextSize(2);
@@ -126,11 +137,19 @@ public:
 
   void print_fg(void)
   {
-    // display IR image and fg predictions
+    // display IR image and fg predictions, only redrawing cells whose colour or state has changed
+    const bool *fg = bg_subtractor->getForegroundImage();
     for (uint16_t i = 0; i < 8 * 8; i++)
     {
-      FGResult res = bg_subtractor->isFG(i);
       uint16_t fill_colour = get_temp_colour(palette, sizeof(palette) / sizeof(palette[0]), temp_data_buf[i], deviceTemp * 0.85, deviceTemp *1.25);
+      if (drawn_valid[i] && drawn_colour[i] == fill_colour && drawn_fg[i] == fg[i])
+      {
+        continue;
+      }
+      drawn_valid[i] = true;
+      drawn_colour[i] = fill_colour;
+      drawn_fg[i] = fg[i];
+
       tft->fillRect(
           (i % 8) * step_x,
           top_buffer_size + ((i / 8) * step_y),
@@ -138,7 +157,7 @@ public:
           step_y,
           fill_colour);
 
-      if (res.isFG)
+      if (fg[i])
       {
         tft->drawRect(
             (i % 8) * step_x,
@@ -217,4 +236,7 @@ protected:
   float deviceTemp;        // internal temp of grideye
   float temp_data_buf[64]; // buffer for IR data
   bool isTraining;
+  uint16_t drawn_colour[64]; // fill colour currently on screen for each cell
+  bool drawn_fg[64];         // whether each cell currently has a foreground outline
+  bool drawn_valid[64];      // false if the cell must be redrawn regardless
 };
@@ -27,12 +27,19 @@ public:
                 temp_data_buffer[i] = grideye->getPixelTemperature(i);
             }
             bg_subtractor->update(temp_data_buffer);
-            
-            for(int x = 0; x < 8; x++)
+
+            // only reprint the grid when the mask has changed
+            if (bg_subtractor->getNumChangedPixels() == 0)
+            {
+                return;
+            }
+
+            const bool *fg = bg_subtractor->getForegroundImage();
+            for(int y = 0; y < 8; y++)
             {
-                for(int y = 0; y < 8; y++)
+                for(int x = 0; x < 8; x++)
                 {
-                    Serial.print(bg_subtractor->isFG(x, y).isFG ? "0 " : ". ");
+                    Serial.print(fg[y * 8 + x] ? "0 " : ". ");
                 }
                 Serial.println();
             }
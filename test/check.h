@@ -0,0 +1,43 @@
+#pragma once
+
+// Minimal checking for the host tests. Each test is a standalone program: it counts failed
+// checks, reports each one on stderr, and returns the result of finish() from main().
+
+#include <stddef.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+// @brief Report and count a failed condition, and carry on
+#define CHECK(cond)                                                                  \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                              \
+        }                                                                            \
+    } while (0)
+
+// @brief Report and count a failure described by the caller, e.g. with the frame it happened in
+#define FAIL(...)                     \
+    do                                \
+    {                                 \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n");        \
+        failures++;                   \
+    } while (0)
+
+// @brief Print the outcome of a test
+// @param name The name of the test
+// @return The exit status for main()
+static int finish(const char *name)
+{
+    if (failures != 0)
+    {
+        fprintf(stderr, "%s: %d failures\n", name, failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Host test of the sizes reported by GMGFootprint.h.
+//
+// Checks MODEL_BYTES and IMAGE_BYTES against sums over the members they cover for a few
+// configurations, checks that a split subtractor leaves its images out of the object, and checks
+// the budgets of the configurations used in this repository at compile time.
+//
+// Build and run on the host from the repository root:
+//
+//     g++ -std=c++17 -O2 -Isrc test/test_footprint.cpp -o test_footprint && ./test_footprint
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "GMGBackgroundSubtractor.h"
+#include "GMGFootprint.h"
+
+#include "check.h"
+
+// @brief Report a size that is not the expected one
+#define CHECK_BYTES(name, actual, expected)                                                           \
+    do                                                                                                \
+    {                                                                                                 \
+        if ((actual) != (expected))                                                                   \
+        {                                                                                             \
+            FAIL("%s: " #actual " is %zu, expected %zu", name, (size_t)(actual), (size_t)(expected)); \
+        }                                                                                             \
+    } while (0)
+
+// Budgets of the configurations used in this repository.
+
+// GridEYE, 8x8, as in main.cpp and the visualisers
+typedef GMGBackgroundSubtractor<float, 8, 8, 32> GridEYESubtractor;
+GMG_FOOTPRINT_BUDGET(GridEYESubtractor, 24 * 1024, 0);
+
+// MLX90640, 32x24, with the model in DTCM and the images in OCRAM
+typedef SplitGMGBackgroundSubtractor<float, 32, 24, 32> MLX90640Subtractor;
+GMG_FOOTPRINT_BUDGET(MLX90640Subtractor, 256 * 1024, 16 * 1024);
+
+static size_t roundUp(size_t bytes, size_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+// @brief Bytes of the per-pixel model, member by member
+static size_t expectedModelBytes(size_t x, size_t y, size_t fMax, size_t activeMax)
+{
+    // a feature is a uint8_t value padded to the alignment of its float weight
+    size_t feature = roundUp(sizeof(uint8_t), alignof(float)) + sizeof(float);
+    // a PMF is the feature count and the features, padded to the larger alignment
+    size_t pmf = roundUp(sizeof(size_t) + fMax * feature, alignof(size_t));
+    // the gating cache is three floats, the bin and two flags, padded to a float
+    size_t gate = roundUp(3 * sizeof(float) + sizeof(uint8_t) + 2 * sizeof(bool), alignof(float));
+
+    // slots only map to pixels when there is room for a region of interest
+    size_t slotPixel = activeMax < x * y ? activeMax * sizeof(uint32_t) : 0;
+
+    return slotPixel                    // _slotPixel
+           + (y + 1) * sizeof(uint32_t) // _rowSlotBegin
+           + activeMax * pmf            // pmf
+           + activeMax * gate           // _gate
+           + activeMax * sizeof(uint8_t); // _quantisedImage
+}
+
+// @brief Bytes of the image buffers, member by member
+static size_t expectedImageBytes(size_t x, size_t y)
+{
+    size_t pixels = x * y;
+    size_t bytes = pixels * sizeof(float)  // posteriorImage
+                   + pixels * sizeof(bool) // rawBinaryImage
+                   + pixels * sizeof(bool) // binaryImage
+                   + (pixels + 7) / 8      // packedMask
+                   + pixels * sizeof(uint32_t); // changedPixels
+    return roundUp(bytes, alignof(uint32_t));
+}
+
+template <typename T, size_t X, size_t Y, size_t F_MAX, size_t ACTIVE_MAX = X * Y>
+static void checkConfiguration(const char *name)
+{
+    typedef GMGFootprint<GMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX>> Internal;
+    typedef GMGFootprint<SplitGMGBackgroundSubtractor<T, X, Y, F_MAX, ACTIVE_MAX>> Split;
+
+    CHECK_BYTES(name, Internal::MODEL_BYTES, expectedModelBytes(X, Y, F_MAX, ACTIVE_MAX));
+    CHECK_BYTES(name, Internal::IMAGE_BYTES, expectedImageBytes(X, Y));
+    CHECK_BYTES(name, Split::MODEL_BYTES, Internal::MODEL_BYTES);
+    CHECK_BYTES(name, Split::IMAGE_BYTES, Internal::IMAGE_BYTES);
+
+    // the images are in the object only when they are internal
+    CHECK_BYTES(name, Internal::EXTERNAL_BYTES, 0);
+    CHECK_BYTES(name, Split::EXTERNAL_BYTES, Split::IMAGE_BYTES);
+    CHECK_BYTES(name, Internal::TOTAL_BYTES, Internal::OBJECT_BYTES);
+    CHECK_BYTES(name, Split::TOTAL_BYTES, Split::OBJECT_BYTES + Split::IMAGE_BYTES);
+    CHECK(Internal::OBJECT_BYTES >= Internal::MODEL_BYTES + Internal::IMAGE_BYTES);
+    CHECK(Split::OBJECT_BYTES >= Split::MODEL_BYTES);
+    CHECK(Split::OBJECT_BYTES + Split::IMAGE_BYTES <= Internal::OBJECT_BYTES + alignof(max_align_t));
+
+    // the rest is per-row counters, image pointers and scalars, nothing per pixel
+    CHECK(Internal::OTHER_BYTES <= Y * 3 * sizeof(uint32_t) + 512);
+    CHECK(Split::OTHER_BYTES <= Y * 3 * sizeof(uint32_t) + 512);
+
+    printf("%-24s model %7zu  images %6zu  object %7zu  split object %7zu\n", name, Internal::MODEL_BYTES,
+           Internal::IMAGE_BYTES, Internal::OBJECT_BYTES, Split::OBJECT_BYTES);
+}
+
+int main(void)
+{
+    checkConfiguration<float, 8, 8, 32>("float 8x8x32");
+    checkConfiguration<float, 8, 8, 16>("float 8x8x16");
+    checkConfiguration<uint16_t, 16, 4, 32>("uint16_t 16x4x32");
+    checkConfiguration<float, 32, 24, 32>("float 32x24x32");
+    checkConfiguration<float, 32, 24, 32, 256>("float 32x24x32, 256 ROI");
+    checkConfiguration<float, 13, 7, 5>("float 13x7x5");
+    checkConfiguration<uint8_t, 80, 60, 8>("uint8_t 80x60x8");
+
+    return finish("test_footprint");
+}
@@ -0,0 +1,105 @@
+// Host test of GMGBackgroundSubtractor's row-major indexing on square and non-square sizes.
+//
+// Trains on a flat frame, then lights up a 2x2 block whose top-left pixel is (x, y) and checks that
+// isFG(x, y), isFG(y * X + x), the foreground image, the packed mask and the bounding box all put
+// it in the same place, and that the transposed position stays background.
+//
+// Build and run on the host from the repository root:
+//
+//     g++ -std=c++17 -O2 -Isrc test/test_indexing.cpp -o test_indexing && ./test_indexing
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include "GMGBackgroundSubtractor.h"
+
+#include "check.h"
+
+static const uint64_t TRAINING_FRAMES = 10;
+
+// @brief Check one hot block at (x, y) on an X by Y subtractor
+template <size_t X, size_t Y>
+static void checkBlock(size_t x, size_t y)
+{
+    typedef GMGBackgroundSubtractor<float, X, Y, 32> Subtractor;
+
+    // too large for the stack at the bigger sizes
+    std::unique_ptr<Subtractor> subtractor(new Subtractor());
+    subtractor->setNumInitialisationFrames(TRAINING_FRAMES);
+    subtractor->setMinVal(0.0f);
+    subtractor->setMaxVal(40.0f);
+
+    std::vector<float> frame(X * Y, 20.0f);
+    for (uint64_t f = 0; f < TRAINING_FRAMES; ++f)
+    {
+        subtractor->update(frame.data());
+    }
+    CHECK(!subtractor->isTraining());
+
+    // a single pixel would be smoothed away, so light up a 2x2 block
+    for (size_t dy = 0; dy < 2; ++dy)
+    {
+        for (size_t dx = 0; dx < 2; ++dx)
+        {
+            frame[(y + dy) * X + (x + dx)] = 35.0f;
+        }
+    }
+    subtractor->update(frame.data());
+
+    size_t idx = y * X + x;
+    CHECK(subtractor->isFG(x, y).isFG);
+    CHECK(subtractor->isFG(idx).isFG);
+    CHECK(subtractor->isFG(x, y).confidence == subtractor->isFG(idx).confidence);
+    CHECK(subtractor->getForegroundImage()[idx]);
+    CHECK((subtractor->getPackedForegroundMask()[idx / 8] >> (idx % 8)) & 1);
+    CHECK(subtractor->getConfidenceImage()[idx] == subtractor->isFG(idx).confidence);
+
+    // nothing else, in particular not where a column-major layout would have put it
+    CHECK(subtractor->getForegroundCount() == 4);
+    if (y < X && x < Y && (x < y || x > y + 1))
+    {
+        CHECK(!subtractor->isFG(y, x).isFG);
+    }
+
+    FGBoundingBox box = subtractor->getBoundingBox();
+    CHECK(box.xMin == x && box.yMin == y && box.xMax == x + 1 && box.yMax == y + 1);
+
+    // the mask reads back row by row in sensor order
+    const bool *mask = subtractor->getForegroundImage();
+    for (size_t py = 0; py < Y; ++py)
+    {
+        for (size_t px = 0; px < X; ++px)
+        {
+            bool expected = px >= x && px <= x + 1 && py >= y && py <= y + 1;
+            if (mask[py * X + px] != expected || subtractor->isFG(px, py).isFG != expected)
+            {
+                FAIL("%zux%zu: pixel (%zu, %zu) is %s", X, Y, px, py, expected ? "background" : "foreground");
+            }
+        }
+    }
+}
+
+template <size_t X, size_t Y>
+static void checkSize(void)
+{
+    checkBlock<X, Y>(0, 0);
+    checkBlock<X, Y>(X - 2, 1);
+    checkBlock<X, Y>(1, Y - 2);
+    checkBlock<X, Y>(X - 2, Y - 2);
+    checkBlock<X, Y>(X / 2, Y / 3);
+}
+
+int main(void)
+{
+    checkSize<8, 8>();
+    checkSize<32, 24>();
+    checkSize<24, 32>();
+    checkSize<80, 60>();
+    checkSize<16, 4>();
+
+    return finish("test_indexing");
+}
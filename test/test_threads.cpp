@@ -0,0 +1,180 @@
+// Host test of GMGBackgroundSubtractor's tile-parallel update against the serial path.
+//
+// Runs the same noisy scene with moving objects through a serial subtractor and through threaded
+// ones with different thread counts and tile sizes, and requires identical masks and bit-identical
+// confidences on every frame. Covered with change gating, with partial model updates on both
+// schedules, and with a region of interest.
+//
+// Build and run on the host from the repository root:
+//
+//     g++ -std=c++17 -O2 -pthread -DGMG_ENABLE_THREADS -Isrc test/test_threads.cpp -o test_threads && ./test_threads
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "GMGBackgroundSubtractor.h"
+#include "GMGThreadPool.h"
+
+#include "check.h"
+
+#if !defined(GMG_ENABLE_THREADS)
+#error "build with -DGMG_ENABLE_THREADS"
+#endif
+
+static const size_t X = 80;
+static const size_t Y = 60;
+static const size_t NUM_FRAMES = 160;
+static const uint64_t TRAINING_FRAMES = 30;
+
+typedef GMGBackgroundSubtractor<float, X, Y, 16> Subtractor;
+// room for the ellipse of the region of interest variant, so its slots map to pixels
+typedef GMGBackgroundSubtractor<float, X, Y, 16, X * Y * 7 / 8> RegionSubtractor;
+
+// Settings applied to both the serial and the threaded subtractor.
+struct Variant
+{
+    const char *name;
+    bool changeGating;
+    size_t updateStride;
+    GMGUpdateSchedule updateSchedule;
+    bool regionOfInterest;
+};
+
+// @brief Restrict to an ellipse, so that rows have different numbers of slots
+static void setRegion(RegionSubtractor &subtractor)
+{
+    uint8_t mask[RegionSubtractor::PACKED_MASK_BYTES] = {};
+    for (size_t y = 0; y < Y; ++y)
+    {
+        for (size_t x = 0; x < X; ++x)
+        {
+            float dx = (x - X / 2.0f) / (X / 2.0f);
+            float dy = (y - Y / 2.0f) / (Y / 2.0f);
+            if (dx * dx + dy * dy <= 1.0f)
+            {
+                mask[(y * X + x) / 8] |= (uint8_t)(1 << ((y * X + x) % 8));
+            }
+        }
+    }
+    CHECK(subtractor.setRegionOfInterest(mask));
+}
+
+// @brief Full frame subtractors always process every pixel
+static void setRegion(Subtractor &)
+{
+}
+
+template <typename S>
+static void configure(S &subtractor, const Variant &variant)
+{
+    subtractor.setNumInitialisationFrames(TRAINING_FRAMES);
+    subtractor.setMinVal(18.0f);
+    subtractor.setMaxVal(34.0f);
+    subtractor.setChangeGating(variant.changeGating);
+    subtractor.setUpdateStride(variant.updateStride);
+    subtractor.setUpdateSchedule(variant.updateSchedule);
+    setRegion(subtractor);
+}
+
+// @brief A room with noise and a few warm objects moving through it
+static void renderFrame(size_t f, std::mt19937 &rng, std::vector<float> &frame)
+{
+    std::normal_distribution<float> noise(0.0f, 0.4f);
+    for (size_t y = 0; y < Y; ++y)
+    {
+        for (size_t x = 0; x < X; ++x)
+        {
+            frame[y * X + x] = 21.0f + sinf(0.3f * x) * cosf(0.2f * y) + noise(rng);
+        }
+    }
+    for (size_t k = 0; k < 3; ++k)
+    {
+        size_t cx = (f * (k + 1) + 20 * k) % (X - 6);
+        size_t cy = (f / 2 + 17 * k) % (Y - 6);
+        for (size_t y = cy; y < cy + 6; ++y)
+        {
+            for (size_t x = cx; x < cx + 6; ++x)
+            {
+                frame[y * X + x] = 30.0f + noise(rng);
+            }
+        }
+    }
+}
+
+template <typename S>
+static void checkVariant(const Variant &variant, GMGThreadPool &pool, size_t tileRows)
+{
+    // too large for the stack
+    std::unique_ptr<S> serial(new S());
+    std::unique_ptr<S> threaded(new S());
+    configure(*serial, variant);
+    configure(*threaded, variant);
+    threaded->setThreadPool(&pool);
+    threaded->setTileRows(tileRows);
+
+    size_t differences = 0;
+    size_t foreground = 0;
+    std::mt19937 rng(7);
+    std::vector<float> frame(X * Y);
+    for (size_t f = 0; f < NUM_FRAMES; ++f)
+    {
+        renderFrame(f, rng, frame);
+        serial->update(frame.data());
+        threaded->update(frame.data());
+
+        differences += memcmp(serial->getForegroundImage(), threaded->getForegroundImage(), X * Y) != 0;
+        differences += memcmp(serial->getConfidenceImage(), threaded->getConfidenceImage(), X * Y * sizeof(float)) != 0;
+        differences += memcmp(serial->getPackedForegroundMask(), threaded->getPackedForegroundMask(),
+                              S::PACKED_MASK_BYTES) != 0;
+        differences += serial->getNumChangedPixels() != threaded->getNumChangedPixels();
+        foreground += serial->getForegroundCount();
+    }
+    if (differences != 0)
+    {
+        FAIL("%s, %zu threads, %zu tile rows: %zu differences from the serial path", variant.name,
+             pool.getNumThreads(), tileRows, differences);
+    }
+    // the comparison means little if nothing was ever detected
+    CHECK(foreground > 0);
+}
+
+int main(void)
+{
+    static const Variant variants[] = {
+        {"default", false, 1, GMG_UPDATE_ROUND_ROBIN, false},
+        {"change gating", true, 1, GMG_UPDATE_ROUND_ROBIN, false},
+        {"stride 4 round robin", false, 4, GMG_UPDATE_ROUND_ROBIN, false},
+        {"stride 4 random", true, 4, GMG_UPDATE_RANDOM, false},
+        {"region of interest", true, 3, GMG_UPDATE_RANDOM, true},
+    };
+    // 0 sizes tiles to about GMG_TILE_BYTES of model, 24 rows here
+    static const size_t tileRows[] = {1, 3, 7, 0};
+
+    for (size_t numThreads : {2, 4})
+    {
+        GMGThreadPool pool(numThreads);
+        for (const Variant &variant : variants)
+        {
+            for (size_t rows : tileRows)
+            {
+                if (variant.regionOfInterest)
+                {
+                    checkVariant<RegionSubtractor>(variant, pool, rows);
+                }
+                else
+                {
+                    checkVariant<Subtractor>(variant, pool, rows);
+                }
+            }
+        }
+    }
+
+    return finish("test_threads");
+}
@@ -0,0 +1,216 @@
+// Host test of the detection and tracking chain on a synthetic scene with ground truth identities.
+//
+// A 32x24 room with sensor noise, in which people walk past each other, cross paths, walk out of
+// view and come in again, is run through GMGBackgroundSubtractor, BlobExtractor and BlobTracker.
+// Every person must be followed by a single confirmed track for as long as they are in view, no
+// two people may share a track, a track must be dropped soon after its person leaves, and a
+// person who comes in must never be given the id of someone else.
+//
+// Build and run on the host from the repository root:
+//
+//     g++ -std=c++17 -O2 -Isrc test/test_tracker.cpp -o test_tracker && ./test_tracker
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "BlobExtractor.h"
+#include "BlobTracker.h"
+#include "GMGBackgroundSubtractor.h"
+
+#include "check.h"
+
+static const size_t X = 32;
+static const size_t Y = 24;
+static const size_t MAX_BLOBS = 8;
+static const size_t MAX_TRACKS = 8;
+static const uint64_t TRAINING_FRAMES = 100;
+
+// Frames a person has to be in view before their track is expected to be confirmed
+static const size_t SETTLE_FRAMES = 6;
+
+// A person walking in a straight line at constant speed between two frames.
+struct Person
+{
+    float x0, y0;  // centre at the first frame
+    float vx, vy;  // pixels per frame
+    size_t enter;  // first frame in view
+    size_t leave;  // first frame out of view
+    float radius;
+
+    bool inView(size_t f) const { return f >= enter && f < leave; }
+    float x(size_t f) const { return x0 + vx * (float)(f - enter); }
+    float y(size_t f) const { return y0 + vy * (float)(f - enter); }
+};
+
+static const size_t NUM_FRAMES = TRAINING_FRAMES + 260;
+
+// All positions are inside the view while in view; people leave by disappearing at the edge.
+static const Person people[] = {
+    // two people walking quickly past each other in opposite directions on rows 5 pixels apart
+    {3.0f, 6.0f, 0.5f, 0.0f, TRAINING_FRAMES + 10, TRAINING_FRAMES + 60, 1.6f},
+    {28.0f, 11.0f, -0.5f, 0.0f, TRAINING_FRAMES + 10, TRAINING_FRAMES + 60, 1.6f},
+    // two people whose paths cross at (16, 15), the second getting there 40 frames after the
+    // first; they are never closer than about 4.4 pixels, so their blobs stay apart
+    {6.0f, 20.0f, 0.2f, -0.1f, TRAINING_FRAMES + 120, TRAINING_FRAMES + 220, 1.4f},
+    {16.0f, 3.0f, 0.0f, 0.2f, TRAINING_FRAMES + 150, TRAINING_FRAMES + 245, 1.4f},
+    // someone who comes in near where the first person left
+    {29.0f, 6.0f, -0.2f, 0.0f, TRAINING_FRAMES + 150, TRAINING_FRAMES + 250, 1.6f},
+};
+static const size_t NUM_PEOPLE = sizeof(people) / sizeof(people[0]);
+
+static void renderFrame(size_t f, std::mt19937 &rng, std::vector<float> &frame)
+{
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    for (size_t y = 0; y < Y; ++y)
+    {
+        for (size_t x = 0; x < X; ++x)
+        {
+            // a fixed pattern of warmer and cooler spots
+            frame[y * X + x] = 21.0f + 0.5f * sinf(0.7f * x) * cosf(0.5f * y) + noise(rng);
+        }
+    }
+    for (const Person &person : people)
+    {
+        if (!person.inView(f))
+        {
+            continue;
+        }
+        for (size_t y = 0; y < Y; ++y)
+        {
+            for (size_t x = 0; x < X; ++x)
+            {
+                float dx = x + 0.5f - person.x(f);
+                float dy = y + 0.5f - person.y(f);
+                if (dx * dx + dy * dy <= person.radius * person.radius)
+                {
+                    frame[y * X + x] = 30.0f + noise(rng);
+                }
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    typedef GMGBackgroundSubtractor<float, X, Y, 32> Subtractor;
+    std::unique_ptr<Subtractor> subtractor(new Subtractor());
+    subtractor->setNumInitialisationFrames(TRAINING_FRAMES);
+    subtractor->setMinVal(18.0f);
+    subtractor->setMaxVal(34.0f);
+
+    BlobExtractor<float, X, Y, MAX_BLOBS> extractor;
+    extractor.setMinArea(3);
+    BlobTracker<MAX_TRACKS, MAX_BLOBS> tracker;
+
+    // the id following each person, 0 until their track is confirmed
+    uint32_t personId[NUM_PEOPLE] = {};
+
+    std::mt19937 rng(1);
+    std::vector<float> frame(X * Y);
+    for (size_t f = 0; f < NUM_FRAMES; ++f)
+    {
+        renderFrame(f, rng, frame);
+        subtractor->update(frame.data());
+        if (subtractor->isTraining())
+        {
+            continue;
+        }
+        extractor.update(subtractor->getPackedForegroundMask(), frame.data());
+        tracker.update(extractor.getBlobs(), extractor.getNumBlobs());
+
+        const Track *tracks = tracker.getTracks();
+        size_t numTracks = tracker.getNumTracks();
+
+        for (size_t i = 0; i < NUM_PEOPLE; ++i)
+        {
+            const Person &person = people[i];
+
+            // a track is dropped once it has missed more than getMaxMisses() frames
+            if (!person.inView(f))
+            {
+                if (personId[i] != 0 && f > person.leave + tracker.getMaxMisses())
+                {
+                    for (size_t t = 0; t < numTracks; ++t)
+                    {
+                        if (tracks[t].id == personId[i])
+                        {
+                            FAIL("frame %zu: track %u of person %zu outlived them", f, personId[i], i);
+                        }
+                    }
+                }
+                continue;
+            }
+            if (f < person.enter + SETTLE_FRAMES)
+            {
+                continue;
+            }
+
+            // the confirmed track closest to the person, which must be close
+            const Track *closest = nullptr;
+            float closestDistance = 0.0f;
+            for (size_t t = 0; t < numTracks; ++t)
+            {
+                float dx = tracks[t].x + 0.5f - person.x(f);
+                float dy = tracks[t].y + 0.5f - person.y(f);
+                float distance = sqrtf(dx * dx + dy * dy);
+                if (tracks[t].confirmed && (closest == nullptr || distance < closestDistance))
+                {
+                    closest = &tracks[t];
+                    closestDistance = distance;
+                }
+            }
+            if (closest == nullptr || closestDistance > 2.0f)
+            {
+                FAIL("frame %zu: person %zu at (%.1f, %.1f) has no track", f, i, person.x(f), person.y(f));
+                continue;
+            }
+
+            // the same track from the frame it is confirmed to the frame the person leaves,
+            // and a fresh id for every person
+            if (personId[i] == 0)
+            {
+                for (size_t j = 0; j < NUM_PEOPLE; ++j)
+                {
+                    CHECK(personId[j] != closest->id);
+                }
+                personId[i] = closest->id;
+            }
+            else if (closest->id != personId[i])
+            {
+                FAIL("frame %zu: person %zu switched from track %u to %u", f, i, personId[i], closest->id);
+                personId[i] = closest->id;
+            }
+        }
+
+        for (size_t i = 0; i < NUM_PEOPLE; ++i)
+        {
+            for (size_t j = i + 1; j < NUM_PEOPLE; ++j)
+            {
+                if (people[i].inView(f) && people[j].inView(f) && personId[i] != 0 && personId[i] == personId[j])
+                {
+                    FAIL("frame %zu: people %zu and %zu share track %u", f, i, j, personId[i]);
+                }
+            }
+        }
+    }
+
+    // everyone was followed at some point, and the scene ends with nobody in view
+    for (size_t i = 0; i < NUM_PEOPLE; ++i)
+    {
+        CHECK(personId[i] != 0);
+    }
+    size_t confirmed = 0;
+    for (size_t t = 0; t < tracker.getNumTracks(); ++t)
+    {
+        confirmed += tracker.getTracks()[t].confirmed;
+    }
+    CHECK(confirmed == 0);
+
+    return finish("test_tracker");
+}
@@ -0,0 +1,599 @@
+// Offline batch runner for GMGBackgroundSubtractor, for tuning its parameters on a workstation.
+//
+// Runs every sequence, recorded or synthetic, through the subtractor once for each combination of
+// the parameter lists given on the command line. Every sequence/parameter pair is an independent
+// job; jobs are spread over a GMGThreadPool, longest first, and each one writes a CSV row as soon
+// as it finishes.
+//
+// Build on the host from the repository root:
+//
+//     g++ -std=c++17 -O2 -pthread -Isrc tools/gmg_batch.cpp -o gmg_batch
+//
+// Example, a sweep over two recordings and eight synthetic sequences:
+//
+//     ./gmg_batch --size 8x8 --min 18 --max 34 --learning-rate 0.01,0.025,0.05
+//         --threshold 0.8,0.9,0.95 --levels 16,32 --synthetic 8 lab.txt hall.txt > sweep.csv
+//
+// A recording is a text file with one frame per line, X * Y values separated by spaces or commas
+// in row-major order, e.g. a serial log of getPixelTemperature(). Lines starting with '#' are
+// ignored. If "<recording>.gt" exists it is read as the ground truth, one line of X * Y zeros and
+// ones per frame, and precision and recall are reported for it. Synthetic sequences always have
+// ground truth.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "GMGBackgroundSubtractor.h"
+#include "GMGThreadPool.h"
+
+// Features per pixel, the same as the firmware in main.cpp.
+static const size_t F_MAX = 32;
+
+// A sequence of frames, with an optional ground truth foreground mask for each.
+struct Sequence
+{
+    std::string name;
+    size_t width;
+    size_t height;
+    std::vector<float> frames;   // numFrames * width * height values, row-major
+    std::vector<uint8_t> truth;  // empty, or one 0/1 per value of frames
+    size_t numFrames(void) const { return frames.size() / (width * height); }
+};
+
+// One combination of the swept parameters.
+struct ParamSet
+{
+    uint16_t quantisationLevels;
+    float backgroundPrior;
+    float learningRate;
+    float decisionThreshold;
+};
+
+// Settings shared by every job.
+struct Options
+{
+    size_t width = 8;
+    size_t height = 8;
+    bool autoRange = true;
+    float minVal = 0.0f;
+    float maxVal = 1.0f;
+    uint64_t initialisationFrames = 240;
+    std::vector<uint16_t> levels = {GMGDefaultConfig::quantisationLevels};
+    std::vector<float> priors = {GMGDefaultConfig::backgroundPrior};
+    std::vector<float> learningRates = {GMGDefaultConfig::learningRate};
+    std::vector<float> thresholds = {GMGDefaultConfig::decisionThreshold};
+    size_t syntheticSequences = 0;
+    size_t syntheticFrames = 2000;
+    uint32_t seed = 1;
+    size_t threads = 0;
+    const char *output = nullptr;
+    std::vector<std::string> recordings;
+};
+
+// Metrics of one job, over the frames after training.
+struct JobResult
+{
+    size_t scoredFrames;
+    double meanForegroundFraction;
+    double meanChangedPixels;
+    uint64_t truePositives;
+    uint64_t falsePositives;
+    uint64_t falseNegatives;
+    double microsPerFrame;
+};
+
+struct Job
+{
+    const Sequence *sequence;
+    ParamSet params;
+};
+
+// Everything the pool's tasks need, passed through GMGThreadPool::run as the context.
+struct Batch
+{
+    const Options *options;
+    std::vector<Job> jobs;
+    FILE *out;
+    std::mutex outMutex;
+    size_t numDone;
+    bool failed;
+};
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: gmg_batch [options] [recording ...]\n"
+            "  --size WxH               sensor size: 8x8, 16x4, 32x24, 80x60 or 160x120 (default 8x8)\n"
+            "  --min V --max V          input range (default: range of each sequence)\n"
+            "  --init-frames N          training frames (default 240)\n"
+            "  --levels L,...           quantisation levels to sweep (default 32)\n"
+            "  --prior P,...            background priors to sweep (default 0.8)\n"
+            "  --learning-rate R,...    learning rates to sweep (default 0.025)\n"
+            "  --threshold T,...        decision thresholds to sweep (default 0.9)\n"
+            "  --synthetic N            add N synthetic sequences with ground truth (default 0)\n"
+            "  --synthetic-frames N     frames per synthetic sequence (default 2000)\n"
+            "  --seed S                 seed of the first synthetic sequence (default 1)\n"
+            "  --threads N              worker threads including the main one, 0 for all (default 0)\n"
+            "  --output FILE            CSV output (default stdout)\n");
+}
+
+template <typename V>
+static bool parseList(const char *arg, std::vector<V> &out)
+{
+    out.clear();
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        char *end;
+        double val = strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0')
+        {
+            return false;
+        }
+        out.push_back((V)val);
+    }
+    return !out.empty();
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (arg[0] != '-')
+        {
+            options.recordings.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char *val = argv[++i];
+        bool ok = true;
+        if (strcmp(arg, "--size") == 0)
+        {
+            ok = sscanf(val, "%zux%zu", &options.width, &options.height) == 2;
+        }
+        else if (strcmp(arg, "--min") == 0)
+        {
+            options.minVal = strtof(val, nullptr);
+            options.autoRange = false;
+        }
+        else if (strcmp(arg, "--max") == 0)
+        {
+            options.maxVal = strtof(val, nullptr);
+            options.autoRange = false;
+        }
+        else if (strcmp(arg, "--init-frames") == 0)
+        {
+            options.initialisationFrames = strtoull(val, nullptr, 10);
+        }
+        else if (strcmp(arg, "--levels") == 0)
+        {
+            ok = parseList(val, options.levels);
+        }
+        else if (strcmp(arg, "--prior") == 0)
+        {
+            ok = parseList(val, options.priors);
+        }
+        else if (strcmp(arg, "--learning-rate") == 0)
+        {
+            ok = parseList(val, options.learningRates);
+        }
+        else if (strcmp(arg, "--threshold") == 0)
+        {
+            ok = parseList(val, options.thresholds);
+        }
+        else if (strcmp(arg, "--synthetic") == 0)
+        {
+            options.syntheticSequences = strtoul(val, nullptr, 10);
+        }
+        else if (strcmp(arg, "--synthetic-frames") == 0)
+        {
+            options.syntheticFrames = strtoul(val, nullptr, 10);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            options.seed = (uint32_t)strtoul(val, nullptr, 10);
+        }
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            options.threads = strtoul(val, nullptr, 10);
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            options.output = val;
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "gmg_batch: bad option %s %s\n", arg, val);
+            return false;
+        }
+    }
+    return true;
+}
+
+// @brief Read one value per pixel per line, skipping blank and comment lines
+// @return false if a line does not hold width * height values
+static bool readFrames(const std::string &path, size_t pixels, std::vector<float> &values)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        return false;
+    }
+    std::string line;
+    size_t lineNum = 0;
+    while (std::getline(in, line))
+    {
+        lineNum++;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream ss(line);
+        size_t count = 0;
+        float val;
+        while (ss >> val)
+        {
+            values.push_back(val);
+            count++;
+        }
+        if (count != pixels)
+        {
+            fprintf(stderr, "gmg_batch: %s:%zu has %zu values, expected %zu\n", path.c_str(), lineNum, count, pixels);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool loadRecording(const std::string &path, const Options &options, Sequence &sequence)
+{
+    size_t pixels = options.width * options.height;
+    sequence.name = path;
+    sequence.width = options.width;
+    sequence.height = options.height;
+    if (!readFrames(path, pixels, sequence.frames))
+    {
+        fprintf(stderr, "gmg_batch: could not read %s\n", path.c_str());
+        return false;
+    }
+
+    std::string truthPath = path + ".gt";
+    if (std::ifstream(truthPath))
+    {
+        std::vector<float> truth;
+        if (!readFrames(truthPath, pixels, truth) || truth.size() != sequence.frames.size())
+        {
+            fprintf(stderr, "gmg_batch: %s does not match %s\n", truthPath.c_str(), path.c_str());
+            return false;
+        }
+        sequence.truth.resize(truth.size());
+        for (size_t i = 0; i < truth.size(); ++i)
+        {
+            sequence.truth[i] = truth[i] != 0.0f;
+        }
+    }
+    return true;
+}
+
+// @brief A room at about 21 degrees with sensor noise, slow drift and a few people at about 30
+// degrees walking through it after the training frames
+static void makeSynthetic(uint32_t seed, const Options &options, Sequence &sequence)
+{
+    size_t width = options.width;
+    size_t height = options.height;
+    size_t pixels = width * height;
+    size_t numFrames = options.syntheticFrames;
+
+    sequence.name = "synthetic-" + std::to_string(seed);
+    sequence.width = width;
+    sequence.height = height;
+    sequence.frames.resize(numFrames * pixels);
+    sequence.truth.assign(numFrames * pixels, 0);
+
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 0.25f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    // fixed pattern of warmer and cooler spots, e.g. radiators and windows
+    std::vector<float> room(pixels);
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        room[i] = 21.0f + 1.5f * uniform(rng) * uniform(rng);
+    }
+
+    struct Person
+    {
+        float x, y, vx, vy, radius;
+        size_t enter, leave;
+    };
+    std::vector<Person> people(1 + rng() % 3);
+    for (Person &person : people)
+    {
+        person.radius = 0.6f + 0.1f * width * uniform(rng);
+        person.x = uniform(rng) * width;
+        person.y = uniform(rng) * height;
+        float speed = (0.02f + 0.05f * uniform(rng)) * width;
+        float angle = 6.2831853f * uniform(rng);
+        person.vx = speed * cosf(angle);
+        person.vy = speed * sinf(angle);
+        person.enter = options.initialisationFrames + rng() % (numFrames / 4 + 1);
+        person.leave = person.enter + rng() % (numFrames / 2 + 1);
+    }
+
+    for (size_t f = 0; f < numFrames; ++f)
+    {
+        float drift = 0.5f * sinf(6.2831853f * f / 1500.0f);
+        float *frame = &sequence.frames[f * pixels];
+        uint8_t *truth = &sequence.truth[f * pixels];
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            frame[i] = room[i] + drift + noise(rng);
+        }
+
+        for (Person &person : people)
+        {
+            // bounce off the edges of the view
+            person.x += person.vx;
+            person.y += person.vy;
+            if (person.x < 0.0f || person.x >= width)
+            {
+                person.vx = -person.vx;
+                person.x += 2.0f * person.vx;
+            }
+            if (person.y < 0.0f || person.y >= height)
+            {
+                person.vy = -person.vy;
+                person.y += 2.0f * person.vy;
+            }
+            if (f < person.enter || f >= person.leave)
+            {
+                continue;
+            }
+            for (size_t y = 0; y < height; ++y)
+            {
+                for (size_t x = 0; x < width; ++x)
+                {
+                    float dx = x + 0.5f - person.x;
+                    float dy = y + 0.5f - person.y;
+                    if (dx * dx + dy * dy <= person.radius * person.radius)
+                    {
+                        frame[y * width + x] = 30.0f + noise(rng);
+                        truth[y * width + x] = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// @brief Run one sequence through a subtractor with one parameter set
+template <size_t X, size_t Y>
+static JobResult runSequence(const Sequence &sequence, const ParamSet &params, const Options &options)
+{
+    typedef GMGBackgroundSubtractor<float, X, Y, F_MAX> Subtractor;
+
+    // far too large for a worker thread's stack at the bigger sizes
+    std::unique_ptr<Subtractor> subtractor(new Subtractor());
+    subtractor->setNumInitialisationFrames(options.initialisationFrames);
+    subtractor->setQuantisationLevels(params.quantisationLevels);
+    subtractor->setBackgroundPrior(params.backgroundPrior);
+    subtractor->setLearningRate(params.learningRate);
+    subtractor->setDecisionThreshold(params.decisionThreshold);
+
+    float minVal = options.minVal;
+    float maxVal = options.maxVal;
+    if (options.autoRange)
+    {
+        minVal = *std::min_element(sequence.frames.begin(), sequence.frames.end());
+        maxVal = *std::max_element(sequence.frames.begin(), sequence.frames.end());
+    }
+    subtractor->setMinVal(minVal);
+    subtractor->setMaxVal(maxVal > minVal ? maxVal : minVal + 1.0f);
+
+    JobResult result = {};
+    uint64_t foreground = 0;
+    uint64_t changed = 0;
+    std::vector<float> frame(X * Y);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t f = 0; f < sequence.numFrames(); ++f)
+    {
+        // update() takes a non-const image, so give it a copy of the shared frame
+        std::copy_n(&sequence.frames[f * X * Y], X * Y, frame.begin());
+        subtractor->update(frame.data());
+        if (subtractor->isTraining())
+        {
+            continue;
+        }
+
+        result.scoredFrames++;
+        foreground += subtractor->getForegroundCount();
+        changed += subtractor->getNumChangedPixels();
+        if (!sequence.truth.empty())
+        {
+            const bool *mask = subtractor->getForegroundImage();
+            const uint8_t *truth = &sequence.truth[f * X * Y];
+            for (size_t i = 0; i < X * Y; ++i)
+            {
+                result.truePositives += mask[i] && truth[i];
+                result.falsePositives += mask[i] && !truth[i];
+                result.falseNegatives += !mask[i] && truth[i];
+            }
+        }
+    }
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    size_t frames = result.scoredFrames > 0 ? result.scoredFrames : 1;
+    result.meanForegroundFraction = (double)foreground / ((double)frames * X * Y);
+    result.meanChangedPixels = (double)changed / frames;
+    result.microsPerFrame = sequence.numFrames() > 0 ? micros / sequence.numFrames() : 0.0;
+    return result;
+}
+
+// @brief Dispatch to the subtractor instantiated for the size of the sequence
+static bool runJob(const Job &job, const Options &options, JobResult &result)
+{
+    size_t width = job.sequence->width;
+    size_t height = job.sequence->height;
+    if (width == 8 && height == 8)
+        result = runSequence<8, 8>(*job.sequence, job.params, options);
+    else if (width == 16 && height == 4)
+        result = runSequence<16, 4>(*job.sequence, job.params, options);
+    else if (width == 32 && height == 24)
+        result = runSequence<32, 24>(*job.sequence, job.params, options);
+    else if (width == 80 && height == 60)
+        result = runSequence<80, 60>(*job.sequence, job.params, options);
+    else if (width == 160 && height == 120)
+        result = runSequence<160, 120>(*job.sequence, job.params, options);
+    else
+        return false;
+    return true;
+}
+
+static void writeHeader(FILE *out)
+{
+    fprintf(out, "sequence,frames,width,height,quantisation_levels,background_prior,learning_rate,"
+                 "decision_threshold,scored_frames,mean_foreground_fraction,mean_changed_pixels,"
+                 "true_positives,false_positives,false_negatives,precision,recall,f1,us_per_frame\n");
+}
+
+static void writeRow(FILE *out, const Job &job, const JobResult &result)
+{
+    const Sequence &sequence = *job.sequence;
+    fprintf(out, "%s,%zu,%zu,%zu,%u,%g,%g,%g,%zu,%.6f,%.3f,",
+            sequence.name.c_str(), sequence.numFrames(), sequence.width, sequence.height,
+            (unsigned)job.params.quantisationLevels, job.params.backgroundPrior, job.params.learningRate,
+            job.params.decisionThreshold, result.scoredFrames, result.meanForegroundFraction,
+            result.meanChangedPixels);
+
+    // leave the accuracy columns empty without ground truth
+    if (sequence.truth.empty())
+    {
+        fprintf(out, ",,,,,,");
+    }
+    else
+    {
+        double tp = (double)result.truePositives;
+        double precision = tp + result.falsePositives > 0 ? tp / (tp + result.falsePositives) : 1.0;
+        double recall = tp + result.falseNegatives > 0 ? tp / (tp + result.falseNegatives) : 1.0;
+        double f1 = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+        fprintf(out, "%llu,%llu,%llu,%.4f,%.4f,%.4f,",
+                (unsigned long long)result.truePositives, (unsigned long long)result.falsePositives,
+                (unsigned long long)result.falseNegatives, precision, recall, f1);
+    }
+    fprintf(out, "%.2f\n", result.microsPerFrame);
+}
+
+// @brief GMGThreadPool task: run one job and write its row
+static void runTask(void *context, size_t task)
+{
+    Batch *batch = static_cast<Batch *>(context);
+    const Job &job = batch->jobs[task];
+
+    JobResult result;
+    bool ok = runJob(job, *batch->options, result);
+
+    std::lock_guard<std::mutex> lock(batch->outMutex);
+    batch->numDone++;
+    if (!ok)
+    {
+        fprintf(stderr, "gmg_batch: %s: unsupported size %zux%zu\n",
+                job.sequence->name.c_str(), job.sequence->width, job.sequence->height);
+        batch->failed = true;
+        return;
+    }
+    // flush every row so a long sweep can be watched, and survives being interrupted
+    writeRow(batch->out, job, result);
+    fflush(batch->out);
+    fprintf(stderr, "\r%zu/%zu jobs", batch->numDone, batch->jobs.size());
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (argc < 2 || !parseOptions(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    std::vector<Sequence> sequences(options.recordings.size() + options.syntheticSequences);
+    for (size_t i = 0; i < options.recordings.size(); ++i)
+    {
+        if (!loadRecording(options.recordings[i], options, sequences[i]))
+        {
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < options.syntheticSequences; ++i)
+    {
+        makeSynthetic(options.seed + (uint32_t)i, options, sequences[options.recordings.size() + i]);
+    }
+
+    Batch batch;
+    batch.options = &options;
+    batch.numDone = 0;
+    batch.failed = false;
+    for (const Sequence &sequence : sequences)
+    {
+        for (uint16_t levels : options.levels)
+            for (float prior : options.priors)
+                for (float learningRate : options.learningRates)
+                    for (float threshold : options.thresholds)
+                        batch.jobs.push_back(Job{&sequence, ParamSet{levels, prior, learningRate, threshold}});
+    }
+    if (batch.jobs.empty())
+    {
+        fprintf(stderr, "gmg_batch: no sequences given\n");
+        return 1;
+    }
+
+    // the pool hands out jobs in order as threads come free, so starting with the longest keeps
+    // one long recording from being left to run on its own at the end
+    std::stable_sort(batch.jobs.begin(), batch.jobs.end(), [](const Job &a, const Job &b) {
+        return a.sequence->frames.size() > b.sequence->frames.size();
+    });
+
+    batch.out = options.output != nullptr ? fopen(options.output, "w") : stdout;
+    if (batch.out == nullptr)
+    {
+        fprintf(stderr, "gmg_batch: could not open %s\n", options.output);
+        return 1;
+    }
+    writeHeader(batch.out);
+
+    GMGThreadPool pool(options.threads);
+    auto start = std::chrono::steady_clock::now();
+    pool.run(batch.jobs.size(), &runTask, &batch);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "\n%zu jobs on %zu threads in %.1f s\n", batch.jobs.size(), pool.getNumThreads(), seconds);
+
+    if (batch.out != stdout)
+    {
+        fclose(batch.out);
+    }
+    return batch.failed ? 1 : 0;
+}